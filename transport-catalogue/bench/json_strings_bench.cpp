@@ -0,0 +1,114 @@
+// Пропускная способность экранирования и разбора строк JSON на строке размером с карту из ответа Map:
+// SVG около 4 МБ, примерно 10% символов которого экранируются (кавычки атрибутов и переводы строк).
+// Замеряются json::Print, json::Writer и разбор напечатанной строки json::Load и json::arena::Load,
+// время - лучшее из RUNS запусков.
+//
+// Собирается и запускается bench/run_benchmarks.sh
+#include "json.h"
+#include "json_arena.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+    const size_t MAP_SIZE = 4 << 20;
+    const int RUNS = 9;
+
+    // SVG из линий маршрутов, кругов и подписей остановок, как у MapRenderer
+    std::string MakeSvgMap() {
+        std::string svg = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"s;
+        for (size_t i = 0; svg.size() < MAP_SIZE; ++i) {
+            const std::string x = std::to_string(100 + i % 500) + ".123456"s;
+            const std::string y = std::to_string(200 + i % 300) + ".654321"s;
+            switch (i % 3) {
+            case 0:
+                svg += "  <polyline points=\""s + x + ","s + y + " "s + y + ","s + x + " "s + x + ","s + x
+                     + "\" fill=\"none\" stroke=\"green\" stroke-width=\"14\" stroke-linecap=\"round\" />\n"s;
+                break;
+            case 1:
+                svg += "  <circle cx=\""s + x + "\" cy=\""s + y + "\" r=\"5\" fill=\"white\" />\n"s;
+                break;
+            default:
+                svg += "  <text fill=\"black\" x=\""s + x + "\" y=\""s + y + "\" dx=\"7\" dy=\"-3\" font-size=\"20\">Stop "s
+                     + std::to_string(i) + "</text>\n"s;
+                break;
+            }
+        }
+        return svg + "</svg>"s;
+    }
+
+    double EscapedShare(std::string_view value) {
+        const auto escaped = std::count_if(value.begin(), value.end(), [](char c) {
+            return c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t';
+        });
+        return static_cast<double>(escaped) / value.size();
+    }
+
+    // лучшее время run в миллисекундах
+    double Measure(const std::function<void()>& run) {
+        double best = 0.0;
+        for (int i = 0; i < RUNS; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    void Report(std::string_view name, size_t bytes, double milliseconds) {
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << milliseconds << " ms"sv
+                  << std::setw(8) << std::setprecision(0) << bytes / 1e3 / milliseconds << " MB/s\n"sv;
+    }
+
+}  // namespace
+
+int main() {
+    const std::string svg = MakeSvgMap();
+    std::cout << "SVG map: "sv << svg.size() << " bytes, "sv << std::setprecision(1) << std::fixed
+              << EscapedShare(svg) * 100 << "% escaped\n"sv;
+
+    const json::Document document{ json::Node(svg) };
+    std::string printed;
+    Report("json::Print"sv, svg.size(), Measure([&] {
+        std::ostringstream out;
+        json::Print(document, out);
+        printed = std::move(out).str();
+    }));
+
+    std::string written;
+    Report("json::Writer"sv, svg.size(), Measure([&] {
+        std::ostringstream out;
+        json::Writer(out, json::Writer::Format::COMPACT).Value(std::string_view(svg));
+        written = std::move(out).str();
+    }));
+    if (written != printed) {
+        std::cerr << "json::Writer and json::Print differ\n"sv;
+        return EXIT_FAILURE;
+    }
+
+    bool loaded = true;
+    Report("json::Load"sv, printed.size(), Measure([&] {
+        loaded = loaded && json::Load(printed).GetRoot().AsString() == svg;
+    }));
+    Report("json::arena::Load"sv, printed.size(), Measure([&] {
+        loaded = loaded && json::arena::Load(printed).GetRoot().AsString() == svg;
+    }));
+    if (!loaded) {
+        std::cerr << "Loaded string differs from the original\n"sv;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Собирает каждый bench/*_bench.cpp с оптимизацией вместе с исходниками проекта (без main.cpp) и запускает его.
+#
+# usage: bench/run_benchmarks.sh [компилятор]
+set -eu
+
+BENCH_DIR=$(realpath "$(dirname "$0")")
+SOURCE_DIR=$(dirname "$BENCH_DIR")
+COMPILER=${1:-g++}
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+SOURCES=()
+for source in "$SOURCE_DIR"/*.cpp; do
+    [ "$(basename "$source")" = main.cpp ] || SOURCES+=("$source")
+done
+
+status=0
+for bench in "$BENCH_DIR"/*_bench.cpp; do
+    name=$(basename "$bench" .cpp)
+    "$COMPILER" -std=c++17 -O2 -DNDEBUG -pthread -I"$SOURCE_DIR" "$bench" "${SOURCES[@]}" -o "$WORK_DIR/$name"
+    echo "== $name"
+    "$WORK_DIR/$name" || status=1
+done
+exit $status
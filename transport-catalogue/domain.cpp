@@ -4,12 +4,34 @@
 namespace domain {
 
 	// Функция определения уникальных остановок
-	size_t GetUniqStops(std::vector<const Stop*> stops) {
-		// сортируем все остановки по наименованию
-		std::sort(stops.begin(), stops.end(), [](const Stop* lhs, const Stop* rhs) { return lhs->name < rhs->name; });
-		// исключаем повторы имен остановок
-		auto last = std::unique(stops.begin(), stops.end(), [](const Stop* lhs, const Stop* rhs) { return lhs->name == rhs->name; });
-		return static_cast<size_t>(std::distance(stops.begin(), last));
+	size_t GetUniqStops(RouteView route) {
+		std::vector<size_t> stop_ids;
+		stop_ids.reserve(route.size());
+		for (const Stop* stop : route) {
+			stop_ids.push_back(stop->id);
+		}
+		// сортируем id остановок и исключаем повторы
+		std::sort(stop_ids.begin(), stop_ids.end());
+		auto last = std::unique(stop_ids.begin(), stop_ids.end());
+		return static_cast<size_t>(std::distance(stop_ids.begin(), last));
+	}
+
+	size_t EncodeRoute(std::vector<uint8_t>& pool, const std::vector<const Stop*>& stops) {
+		const size_t offset = pool.size();
+		int64_t prev_id = 0;
+		for (const Stop* stop : stops) {
+			const int64_t delta = static_cast<int64_t>(stop->id) - prev_id;
+			prev_id = static_cast<int64_t>(stop->id);
+
+			// zigzag: малые по модулю разности любого знака дают малые беззнаковые числа
+			uint64_t value = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+			while (value >= 0x80) {
+				pool.push_back(static_cast<uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			pool.push_back(static_cast<uint8_t>(value));
+		}
+		return offset;
 	}
 
 }
\ No newline at end of file
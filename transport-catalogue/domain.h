@@ -1,10 +1,14 @@
 ﻿#pragma once
-#include <set>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "geo.h"
+#include "ranges.h"
 
 
 namespace domain {
@@ -12,14 +16,170 @@ namespace domain {
 	struct Stop {
 		std::string name;
 		geo::Coordinates coordinates;
+		size_t id = 0;  // порядковый номер остановки в каталоге
 	};
 
+	// Маршрут хранится один раз, в объявленном направлении: id остановок лежат в общем пуле каталога
+	// в виде разностей соседних id, закодированных zigzag-varint (обычно 1 байт на остановку).
+	// Полный обход некольцевого маршрута (туда и обратно) строится на лету через RouteView
 	struct Bus {
 		std::string name;
-		std::vector<const Stop*> route;
-		bool is_roundtrip;
+		size_t route_offset = 0;  // начало маршрута в пуле
+		size_t stops_count = 0;  // число остановок в объявленном направлении
+		bool is_roundtrip = false;
+		size_t id = 0;  // порядковый номер автобуса в каталоге
 	};
 
+	// дописывает в пул маршрут из остановок stops, возвращает смещение его начала
+	size_t EncodeRoute(std::vector<uint8_t>& pool, const std::vector<const Stop*>& stops);
+
+	// Вид на закодированный маршрут. Для некольцевого маршрута A-B-C в режиме полного обхода
+	// итерирование выдает A-B-C-B-A, в объявленном направлении - A-B-C.
+	// Некольцевой маршрут из одной остановки A в полном обходе - A-A: туда и обратно
+	class RouteView {
+	public:
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = const Stop*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const value_type*;
+			using reference = value_type;
+
+			Iterator(const RouteView& route, size_t index)
+				: data_(route.data_)
+				, stops_(route.stops_)
+				, stops_count_(route.stops_count_)
+				, size_(route.size_)
+				, index_(index)
+			{
+				if (index_ < size_) {
+					stop_id_ = static_cast<size_t>(DecodeDelta(data_, pos_));
+				}
+			}
+
+			const Stop* operator*() const {
+				return &(*stops_)[stop_id_];
+			}
+
+			Iterator& operator++() {
+				++index_;
+				if (index_ >= size_) {
+					return *this;
+				}
+				if (index_ < stops_count_) {
+					// прямое направление: переходим к следующему varint и прибавляем разность
+					pos_ += VarintLength(data_ + pos_);
+					stop_id_ += static_cast<size_t>(DecodeDelta(data_, pos_));
+				}
+				else if (stops_count_ > 1) {
+					// обратное направление: вычитаем разность текущей остановки и отступаем к предыдущему varint
+					stop_id_ -= static_cast<size_t>(DecodeDelta(data_, pos_));
+					pos_ = PrevVarint(data_, pos_);
+				}
+				// маршрут из одной остановки возвращается в нее же
+				return *this;
+			}
+
+			Iterator operator++(int) {
+				Iterator prev = *this;
+				++*this;
+				return prev;
+			}
+
+			bool operator==(const Iterator& other) const {
+				return index_ == other.index_;
+			}
+			bool operator!=(const Iterator& other) const {
+				return !(*this == other);
+			}
+
+		private:
+			const uint8_t* data_;
+			const std::deque<Stop>* stops_;
+			size_t stops_count_;
+			size_t size_;
+			size_t index_;  // номер остановки в обходе
+			size_t pos_ = 0;  // смещение varint текущей остановки в данных маршрута
+			size_t stop_id_ = 0;
+
+			static size_t VarintLength(const uint8_t* data) {
+				size_t length = 1;
+				while (*data++ & 0x80) {
+					++length;
+				}
+				return length;
+			}
+
+			static int64_t DecodeDelta(const uint8_t* data, size_t pos) {
+				uint64_t value = 0;
+				int shift = 0;
+				for (data += pos; *data & 0x80; ++data, shift += 7) {
+					value |= static_cast<uint64_t>(*data & 0x7F) << shift;
+				}
+				value |= static_cast<uint64_t>(*data) << shift;
+				return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+			}
+
+			// последний байт varint не имеет старшего бита, поэтому начало предыдущего varint
+			// находится сразу после предпредыдущего такого байта
+			static size_t PrevVarint(const uint8_t* data, size_t pos) {
+				--pos;
+				while (pos > 0 && (data[pos - 1] & 0x80)) {
+					--pos;
+				}
+				return pos;
+			}
+		};
+
+		RouteView(const uint8_t* data, size_t stops_count, bool full_loop, const std::deque<Stop>& stops)
+			: data_(data)
+			, stops_count_(stops_count)
+			, size_(full_loop && stops_count > 0 ? std::max<size_t>(stops_count * 2 - 1, 2) : stops_count)
+			, stops_(&stops)
+		{
+		}
+
+		Iterator begin() const {
+			return Iterator(*this, 0);
+		}
+		Iterator end() const {
+			return Iterator(*this, size_);
+		}
+
+		// число остановок в обходе
+		size_t size() const {
+			return size_;
+		}
+		bool empty() const {
+			return size_ == 0;
+		}
+
+		// первая остановка маршрута
+		const Stop* front() const {
+			return *begin();
+		}
+		// последняя остановка в объявленном направлении (конечная)
+		const Stop* terminal() const {
+			return *std::next(Declared().begin(), stops_count_ - 1);
+		}
+
+		// тот же маршрут только в объявленном направлении
+		RouteView Declared() const {
+			return RouteView(data_, stops_count_, false, *stops_);
+		}
+
+	private:
+		const uint8_t* data_;
+		size_t stops_count_;  // число остановок в объявленном направлении
+		size_t size_;  // число остановок в обходе
+		const std::deque<Stop>* stops_;
+	};
+
+	// диапазоны маршрутов и остановок, отсортированных по имени (вид на данные каталога, без копирования)
+	using BusRange = ranges::Range<std::vector<const Bus*>::const_iterator>;
+	using StopRange = ranges::Range<std::vector<const Stop*>::const_iterator>;
+
 	struct BusInfo {
 		std::string_view bus_name;
 		size_t stops = 0;
@@ -31,7 +191,13 @@ namespace domain {
 
 	struct StopInfo {
 		size_t request_id;  // номер запроса
-		std::set<std::string_view> buses;  // список маршрутов
+		BusRange buses;  // список маршрутов
+	};
+
+	// автобус, которым можно доехать между двумя остановками без пересадки
+	struct DirectBus {
+		const Bus* bus = nullptr;
+		size_t span_count = 0;  // минимальное число перегонов в направлении движения
 	};
 
 	struct StopPairHasher {
@@ -47,6 +213,6 @@ namespace domain {
 		}
 	};
 
-	size_t GetUniqStops(std::vector<const Stop*> stops);
+	size_t GetUniqStops(RouteView route);
 
 }  // namespace domain
\ No newline at end of file
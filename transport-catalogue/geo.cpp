@@ -1,21 +1,61 @@
-#define _USE_MATH_DEFINES
 #include "geo.h"
 
 #include <cmath>
 
 namespace geo {
 
-    const int EARTH_RADIUS = 6371000;
-
     double ComputeDistance(Coordinates from, Coordinates to) {
         using namespace std;
         if (from == to) {
             return 0;
         }
-        const double dr = M_PI / 180.0;
+        const double dr = DEGREES_TO_RADIANS;
         return acos(sin(from.lat * dr) * sin(to.lat * dr)
             + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
             * EARTH_RADIUS;
     }
 
+    CachedCoordinates CacheCoordinates(Coordinates coords) {
+        const double dr = DEGREES_TO_RADIANS;
+        return { coords, std::sin(coords.lat * dr), std::cos(coords.lat * dr) };
+    }
+
+    namespace {
+
+        // Расчет разбит на проходы по массиву: в проходах со стандартными функциями остаются только
+        // cos и acos, а арифметика между ними идет отдельным циклом без ветвлений и векторизуется компилятором
+        template <typename FromAt, typename ToAt>
+        void ComputeDistancesBatch(size_t count, double* distances, FromAt from_at, ToAt to_at) {
+            const double dr = DEGREES_TO_RADIANS;
+
+            for (size_t i = 0; i < count; ++i) {
+                distances[i] = std::cos(std::abs(from_at(i).coordinates.lng - to_at(i).coordinates.lng) * dr);
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                const CachedCoordinates& from = from_at(i);
+                const CachedCoordinates& to = to_at(i);
+                distances[i] = from.sin_lat * to.sin_lat + from.cos_lat * to.cos_lat * distances[i];
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                distances[i] = from_at(i).coordinates == to_at(i).coordinates ? 0 : std::acos(distances[i]) * EARTH_RADIUS;
+            }
+        }
+
+    }  // namespace
+
+    void ComputeDistances(const CachedCoordinates* from, const CachedCoordinates* to, size_t count, double* distances) {
+        ComputeDistancesBatch(count, distances,
+            [from](size_t i) -> const CachedCoordinates& { return from[i]; },
+            [to](size_t i) -> const CachedCoordinates& { return to[i]; });
+    }
+
+    void ComputeDistances(const CachedCoordinates* points, const size_t* from_ids, const size_t* to_ids,
+                          size_t count, double* distances) {
+        ComputeDistancesBatch(count, distances,
+            [points, from_ids](size_t i) -> const CachedCoordinates& { return points[from_ids[i]]; },
+            [points, to_ids](size_t i) -> const CachedCoordinates& { return points[to_ids[i]]; });
+    }
+
 }  // namespace geo
\ No newline at end of file
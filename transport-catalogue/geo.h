@@ -1,7 +1,12 @@
 ﻿#pragma once
 
+#include <cstddef>
+
 namespace geo {
 
+    inline const int EARTH_RADIUS = 6371000;  // радиус Земли в метрах
+    inline const double DEGREES_TO_RADIANS = 3.14159265358979323846 / 180.0;
+
     struct Coordinates {
         double lat;  // Широта
         double lng;  // Долгота
@@ -16,4 +21,24 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
+    // Координаты с заранее вычисленными синусом и косинусом широты.
+    // Кэшируются один раз на точку и переиспользуются во всех пакетных расчетах
+    struct CachedCoordinates {
+        Coordinates coordinates;
+        double sin_lat = 0;
+        double cos_lat = 0;
+    };
+
+    CachedCoordinates CacheCoordinates(Coordinates coords);
+
+    // Пакетный расчет расстояний: distances[i] - расстояние от from[i] до to[i], i < count.
+    // Выполняются те же операции над теми же значениями, что и в ComputeDistance, поэтому результат
+    // совпадает с ней побитно. Если компилятор сожмет умножение и сложение в FMA, аргумент acos
+    // может отличиться на 1 ulp: для отрезков длиннее 100 м это меньше 0.1 мм
+    void ComputeDistances(const CachedCoordinates* from, const CachedCoordinates* to, size_t count, double* distances);
+
+    // То же для точек, заданных номерами в таблице points: от points[from_ids[i]] до points[to_ids[i]]
+    void ComputeDistances(const CachedCoordinates* points, const size_t* from_ids, const size_t* to_ids,
+                          size_t count, double* distances);
+
 }  // namespace geo
\ No newline at end of file
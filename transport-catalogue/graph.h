@@ -3,6 +3,7 @@
 #include "ranges.h"
 
 #include <cstdlib>
+#include <string>
 #include <vector>
 
 namespace graph {
@@ -10,6 +11,12 @@ namespace graph {
     using VertexId = size_t;
     using EdgeId = size_t;
 
+    enum class EdgeType {
+        WAIT,  // ожидание на остановке, name - остановка
+        BUS,  // поездка, name - автобус, quality - число перегонов
+        WALK,  // пешком до соседней остановки, name - остановка назначения
+    };
+
     template <typename Weight>
     struct Edge {
         std::string name;
@@ -17,6 +24,7 @@ namespace graph {
         VertexId from;
         VertexId to;
         Weight weight;
+        EdgeType type = EdgeType::BUS;
     };
 
     template <typename Weight>
@@ -1,164 +1,234 @@
 ﻿#include "json.h"
+#include "json_internal.h"
 
-#include <iterator>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include <string_view>
+#include <system_error>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace json {
 
-    namespace {
+    namespace detail {
         using namespace std::literals;
 
-        Node LoadNode(std::istream& input);
-        Node LoadString(std::istream& input);
-
-        std::string LoadLiteral(std::istream& input) {
-            std::string s;
-            while (std::isalpha(input.peek())) {
-                s.push_back(static_cast<char>(input.get()));
+        void Scanner::SkipSpaces() {
+            // обычно пробелов нет совсем или это короткий отступ
+            if (pos_ == input_.size() || !IsSpace(input_[pos_])) {
+                return;
             }
-            return s;
-        }
-
-        Node LoadArray(std::istream& input) {
-            std::vector<Node> result;
-
-            for (char c; input >> c && c != ']';) {
-                if (c != ',') {
-                    input.putback(c);
+#ifdef __SSE2__
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i control_span = _mm_set1_epi8('\r' - '\t');
+            while (pos_ + 16 <= input_.size()) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_.data() + pos_));
+                // \t..\r идут подряд: c - '\t' <= '\r' - '\t' без знака
+                const __m128i shifted = _mm_sub_epi8(chunk, tab);
+                const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, control_span), shifted);
+                const __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), is_control);
+                const unsigned not_space = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu;
+                if (not_space != 0) {
+                    pos_ += __builtin_ctz(not_space);
+                    return;
                 }
-                result.push_back(LoadNode(input));
+                pos_ += 16;
             }
-            if (!input) {
-                throw ParsingError("Array parsing error"s);
+#endif
+            while (pos_ < input_.size() && IsSpace(input_[pos_])) {
+                ++pos_;
             }
-            return Node(std::move(result));
         }
 
-        Node LoadDict(std::istream& input) {
-            Dict dict;
-
-            for (char c; input >> c && c != '}';) {
-                if (c == '"') {
-                    std::string key = LoadString(input).AsString();
-                    if (input >> c && c == ':') {
-                        if (dict.find(key) != dict.end()) {
-                            throw ParsingError("Duplicate key '"s + key + "' have been found");
-                        }
-                        dict.emplace(std::move(key), LoadNode(input));
-                    }
-                    else {
-                        throw ParsingError(": is expected but '"s + c + "' has been found"s);
-                    }
+        size_t Scanner::FindStringSpecial() const {
+            size_t pos = pos_;
+#ifdef __SSE2__
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i line_feed = _mm_set1_epi8('\n');
+            const __m128i carriage_return = _mm_set1_epi8('\r');
+            while (pos + 16 <= input_.size()) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_.data() + pos));
+                const __m128i special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+                const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+                if (mask != 0) {
+                    return pos + __builtin_ctz(mask);
                 }
-                else if (c != ',') {
-                    throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+                pos += 16;
+            }
+#endif
+            while (pos < input_.size()) {
+                const char c = input_[pos];
+                if (c == '"' || c == '\\' || c == '\n' || c == '\r') {
+                    break;
                 }
+                ++pos;
             }
-            if (!input) {
-                throw ParsingError("Dictionary parsing error"s);
+            return pos;
+        }
+
+        std::string_view Scanner::LoadLiteral() {
+            const size_t begin = pos_;
+            while (std::isalpha(Peek())) {
+                ++pos_;
             }
-            return Node(std::move(dict));
+            return input_.substr(begin, pos_ - begin);
         }
 
-        Node LoadString(std::istream& input) {
-            auto it = std::istreambuf_iterator<char>(input);
-            auto end = std::istreambuf_iterator<char>();
-            std::string s;
+        std::string_view Scanner::LoadString(std::string& buffer) {
+            size_t special = FindStringSpecial();
+            // строка без экранирования (обычный случай) не копируется
+            if (special < input_.size() && input_[special] == '"') {
+                const std::string_view result = input_.substr(pos_, special - pos_);
+                pos_ = special + 1;
+                return result;
+            }
+
+            buffer.clear();
             while (true) {
-                if (it == end) {
+                // кусок до ближайшего специального символа копируется целиком
+                buffer.append(input_.data() + pos_, special - pos_);
+                pos_ = special;
+                if (pos_ == input_.size()) {
                     throw ParsingError("String parsing error");
                 }
-                const char ch = *it;
+
+                const char ch = input_[pos_++];
                 if (ch == '"') {
-                    ++it;
                     break;
                 }
                 else if (ch == '\\') {
-                    ++it;
-                    if (it == end) {
+                    if (pos_ == input_.size()) {
                         throw ParsingError("String parsing error");
                     }
-                    const char escaped_char = *(it);
+                    const char escaped_char = input_[pos_++];
                     switch (escaped_char) {
                     case 'n':
-                        s.push_back('\n');
+                        buffer.push_back('\n');
                         break;
                     case 't':
-                        s.push_back('\t');
+                        buffer.push_back('\t');
                         break;
                     case 'r':
-                        s.push_back('\r');
+                        buffer.push_back('\r');
                         break;
                     case '"':
-                        s.push_back('"');
+                        buffer.push_back('"');
                         break;
                     case '\\':
-                        s.push_back('\\');
+                        buffer.push_back('\\');
                         break;
                     default:
                         throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
                     }
                 }
-                else if (ch == '\n' || ch == '\r') {
+                else {
                     throw ParsingError("Unexpected end of line"s);
                 }
-                else {
-                    s.push_back(ch);
+                special = FindStringSpecial();
+            }
+            return buffer;
+        }
+
+        void Scanner::SkipString() {
+            while (true) {
+                pos_ = FindStringSpecial();
+                if (pos_ == input_.size()) {
+                    throw ParsingError("String parsing error");
+                }
+                const char ch = input_[pos_++];
+                if (ch == '"') {
+                    return;
+                }
+                if (ch != '\\') {
+                    throw ParsingError("Unexpected end of line"s);
+                }
+                if (pos_ == input_.size()) {
+                    throw ParsingError("String parsing error");
                 }
-                ++it;
+                ++pos_;
             }
+        }
 
-            return Node(std::move(s));
+        std::string_view Scanner::SkipValue() {
+            SkipSpaces();
+            const size_t begin = pos_;
+            // закрывающие скобки открытых массивов и словарей
+            std::string closing;
+            do {
+                if (pos_ == input_.size()) {
+                    throw ParsingError("Unexpected EOF"s);
+                }
+                const char c = input_[pos_++];
+                if (c == '"') {
+                    SkipString();
+                }
+                else if (c == '[' || c == '{') {
+                    closing.push_back(c == '[' ? ']' : '}');
+                }
+                else if (c == ']' || c == '}') {
+                    if (closing.empty() || closing.back() != c) {
+                        throw ParsingError("Unexpected '"s + c + "' has been found"s);
+                    }
+                    closing.pop_back();
+                }
+                else if (closing.empty()) {
+                    // число или литерал в корне значения: до разделителя
+                    while (pos_ < input_.size() && !IsSpace(input_[pos_])
+                           && input_[pos_] != ',' && input_[pos_] != ']' && input_[pos_] != '}') {
+                        ++pos_;
+                    }
+                }
+            } while (!closing.empty());
+            return input_.substr(begin, pos_ - begin);
         }
 
-        Node LoadBool(std::istream& input) {
-            const auto s = LoadLiteral(input);
+        bool Scanner::LoadBool() {
+            const auto s = LoadLiteral();
             if (s == "true"sv) {
-                return Node{ true };
+                return true;
             }
             else if (s == "false"sv) {
-                return Node{ false };
+                return false;
             }
             else {
-                throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+                throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
             }
         }
 
-        Node LoadNull(std::istream& input) {
-            if (auto literal = LoadLiteral(input); literal == "null"sv) {
-                return Node{ nullptr };
-            }
-            else {
-                throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+        void Scanner::LoadNull() {
+            if (auto literal = LoadLiteral(); literal != "null"sv) {
+                throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
             }
         }
 
-        Node LoadNumber(std::istream& input) {
-            std::string parsed_num;
-
-            // Считывает в parsed_num очередной символ из input
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
-                }
-                };
+        std::variant<int, int64_t, double> Scanner::LoadNumber() {
+            const size_t begin = pos_;
 
-            // Считывает одну или более цифр в parsed_num из input
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
+            // Считывает одну или более цифр
+            auto read_digits = [this] {
+                if (!std::isdigit(Peek())) {
                     throw ParsingError("A digit is expected"s);
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+                while (std::isdigit(Peek())) {
+                    ++pos_;
                 }
                 };
 
-            if (input.peek() == '-') {
-                read_char();
+            if (Peek() == '-') {
+                ++pos_;
             }
             // Парсим целую часть числа
-            if (input.peek() == '0') {
-                read_char();
+            if (Peek() == '0') {
+                ++pos_;
                 // После 0 в JSON не могут идти другие цифры
             }
             else {
@@ -167,52 +237,236 @@ namespace json {
 
             bool is_int = true;
             // Парсим дробную часть числа
-            if (input.peek() == '.') {
-                read_char();
+            if (Peek() == '.') {
+                ++pos_;
                 read_digits();
                 is_int = false;
             }
 
             // Парсим экспоненциальную часть числа
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+            if (int ch = Peek(); ch == 'e' || ch == 'E') {
+                ++pos_;
+                if (ch = Peek(); ch == '+' || ch == '-') {
+                    ++pos_;
                 }
                 read_digits();
                 is_int = false;
             }
 
-            try {
-                if (is_int) {
-                    // Сначала пробуем преобразовать строку в int
-                    try {
-                        return std::stoi(parsed_num);
-                    }
-                    catch (...) {
-                        // В случае неудачи, например, при переполнении
-                        // код ниже попробует преобразовать строку в double
+            // числа разбираются без учета локали и без исключений; целое, не помещающееся
+            // в 64 бита, читается как double
+            const std::string_view number = input_.substr(begin, pos_ - begin);
+            const char* first = number.data();
+            const char* last = first + number.size();
+            if (is_int) {
+                int64_t value = 0;
+                if (std::from_chars(first, last, value).ec == std::errc{}) {
+                    if (value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()) {
+                        return static_cast<int>(value);
                     }
+                    return value;
+                }
+            }
+
+            double value = 0.0;
+            if (std::from_chars(first, last, value).ec != std::errc{}) {
+                throw ParsingError("Failed to convert "s + std::string(number) + " to number"s);
+            }
+            return value;
+        }
+
+        namespace {
+
+            // второй символ экранирования после '\\'
+            char EscapeSecond(char c) {
+                switch (c) {
+                case '\n':
+                    return 'n';
+                case '\r':
+                    return 'r';
+                case '\t':
+                    return 't';
+                default:  // '"' и '\\' остаются как есть
+                    return c;
+                }
+            }
+
+            bool IsEscaped(char c) {
+                return c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t';
+            }
+
+        }  // namespace
+
+        char* EscapeChars(std::string_view value, char* out) {
+            const char* pos = value.data();
+            const char* const end = pos + value.size();
+#ifdef __SSE2__
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i line_feed = _mm_set1_epi8('\n');
+            const __m128i carriage_return = _mm_set1_epi8('\r');
+            const __m128i tab = _mm_set1_epi8('\t');
+            while (end - pos >= 16) {
+                // блок записывается целиком, даже если в нем есть экранируемый символ:
+                // запись до него верна, остальное перепишется со следующей позиции
+                // (места хватает: на каждый оставшийся входной символ приходится два выходных)
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chunk);
+                const __m128i escaped = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)),
+                                 _mm_cmpeq_epi8(chunk, tab)));
+                const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(escaped));
+                if (mask == 0) {
+                    pos += 16;
+                    out += 16;
+                    continue;
+                }
+                const unsigned first = __builtin_ctz(mask);
+                pos += first;
+                out += first;
+                *out++ = '\\';
+                *out++ = EscapeSecond(*pos++);
+            }
+#endif
+            for (; pos != end; ++pos) {
+                if (IsEscaped(*pos)) {
+                    *out++ = '\\';
+                    *out++ = EscapeSecond(*pos);
+                }
+                else {
+                    *out++ = *pos;
                 }
-                return std::stod(parsed_num);
             }
-            catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+            return out;
+        }
+
+        void PrintString(std::string_view value, std::ostream& out) {
+            // длинные строки (например, SVG карты) экранируются кусками в буфер на стеке
+            constexpr size_t PART_SIZE = 4096;
+            char buffer[2 * PART_SIZE];
+
+            out.put('"');
+            for (size_t pos = 0; pos < value.size(); pos += PART_SIZE) {
+                const char* end = EscapeChars(value.substr(pos, PART_SIZE), buffer);
+                out.write(buffer, end - buffer);
+            }
+            out.put('"');
+        }
+
+        std::string_view FormatInt(int64_t value, NumberBuffer& buffer) {
+            const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            return { buffer.data(), static_cast<size_t>(result.ptr - buffer.data()) };
+        }
+
+        std::string_view FormatDouble(double value, NumberBuffer& buffer) {
+            // без формата и точности to_chars дает кратчайшую точную запись
+            const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            return { buffer.data(), static_cast<size_t>(result.ptr - buffer.data()) };
+        }
+
+        // поток читается целиком блоками, документ затем разбирается из памяти
+        std::string ReadAll(std::istream& input) {
+            std::string buffer;
+            char chunk[1 << 16];
+            while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+                buffer.append(chunk, static_cast<size_t>(input.gcount()));
             }
+            return buffer;
         }
 
-        Node LoadNode(std::istream& input) {
+    }  // namespace detail
+
+    namespace {
+        using namespace std::literals;
+
+        // разбор в дерево Node
+        class Parser : private detail::Scanner {
+        public:
+            using Scanner::Scanner;
+
+            Node LoadNode();
+
+            // корневой словарь, массивы под ключами streamed_keys отдаются в handler по элементам
+            Node LoadStreamingRoot(const std::vector<std::string_view>& streamed_keys, const ElementHandler& handler);
+
+        private:
+            // ключи корневого словаря, массивы под которыми не собираются в дерево
+            const std::vector<std::string_view>* streamed_keys_ = nullptr;
+            const ElementHandler* handler_ = nullptr;
+            std::string string_;  // буфер строк с экранированием
+
+            Node LoadArray();
+            Node LoadDict(bool is_streaming_root = false);
+        };
+
+        Node Parser::LoadArray() {
+            std::vector<Node> result;
+            LoadElements([this, &result] {
+                result.push_back(LoadNode());
+                });
+            return Node(std::move(result));
+        }
+
+        Node Parser::LoadStreamingRoot(const std::vector<std::string_view>& streamed_keys, const ElementHandler& handler) {
+            streamed_keys_ = &streamed_keys;
+            handler_ = &handler;
+
+            SkipSpaces();
+            if (Peek() != '{') {
+                // не словарь разбирается как обычно
+                return LoadNode();
+            }
+            char brace;
+            ReadNonSpace(brace);
+            return LoadDict(true);
+        }
+
+        Node Parser::LoadDict(bool is_streaming_root) {
+            Dict dict;
+
+            LoadMembers([&](std::string_view key_view) {
+                // место ключа ищется один раз: и для проверки повтора, и для вставки
+                const auto position = dict.lower_bound(key_view);
+                if (position != dict.end() && position->first == key_view) {
+                    throw ParsingError("Duplicate key '"s + std::string(key_view) + "' have been found");
+                }
+                // ключ копируется до разбора значения, которое может переиспользовать его буфер
+                std::string key(key_view);
+                if (is_streaming_root
+                    && std::find(streamed_keys_->begin(), streamed_keys_->end(), key) != streamed_keys_->end()) {
+                    SkipSpaces();
+                    if (Peek() == '[') {
+                        char bracket;
+                        ReadNonSpace(bracket);
+                        LoadElements([this, &key] {
+                            (*handler_)(key, LoadNode());
+                            });
+                        dict.emplace_hint(position, std::move(key), Array{});
+                        return;
+                    }
+                }
+                dict.emplace_hint(position, std::move(key), LoadNode());
+                });
+
+            return Node(std::move(dict));
+        }
+
+        Node Parser::LoadNode() {
             char c;
-            if (!(input >> c)) {
+            if (!ReadNonSpace(c)) {
                 throw ParsingError("Unexpected EOF"s);
             }
             switch (c) {
             case '[':
-                return LoadArray(input);
+                return LoadArray();
             case '{':
-                return LoadDict(input);
-            case '"':
-                return LoadString(input);
+                return LoadDict();
+            case '"': {
+                const std::string_view value = LoadString(string_);
+                // раскодированная в буфер строка забирается без копирования
+                return Node(value.data() == string_.data() ? std::move(string_) : std::string(value));
+            }
             case 't':
                 // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
                 // подсказкой компилятору и человеку, что здесь программист явно задумывал
@@ -222,14 +476,17 @@ namespace json {
                 // литералов true либо false
                 [[fallthrough]];
             case 'f':
-                input.putback(c);
-                return LoadBool(input);
+                Unread();
+                return Node{ LoadBool() };
             case 'n':
-                input.putback(c);
-                return LoadNull(input);
+                Unread();
+                LoadNull();
+                return Node{ nullptr };
             default:
-                input.putback(c);
-                return LoadNumber(input);
+                Unread();
+                return std::visit([](auto number) {
+                    return Node(number);
+                    }, LoadNumber());
             }
         }
 
@@ -256,36 +513,27 @@ namespace json {
             ctx.out << value;
         }
 
-        void PrintString(const std::string& value, std::ostream& out) {
-            out.put('"');
-            for (const char c : value) {
-                switch (c) {
-                case '\r':
-                    out << "\\r"sv;
-                    break;
-                case '\n':
-                    out << "\\n"sv;
-                    break;
-                case '\t':
-                    out << "\\t"sv;
-                    break;
-                case '"':
-                    // Символы " и \ выводятся как \" или \\, соответственно
-                    [[fallthrough]];
-                case '\\':
-                    out.put('\\');
-                    [[fallthrough]];
-                default:
-                    out.put(c);
-                    break;
-                }
-            }
-            out.put('"');
+        template <>
+        void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
+            detail::PrintString(value, ctx.out);
         }
 
         template <>
-        void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
-            PrintString(value, ctx.out);
+        void PrintValue<int>(const int& value, const PrintContext& ctx) {
+            detail::NumberBuffer buffer;
+            ctx.out << detail::FormatInt(value, buffer);
+        }
+
+        template <>
+        void PrintValue<int64_t>(const int64_t& value, const PrintContext& ctx) {
+            detail::NumberBuffer buffer;
+            ctx.out << detail::FormatInt(value, buffer);
+        }
+
+        template <>
+        void PrintValue<double>(const double& value, const PrintContext& ctx) {
+            detail::NumberBuffer buffer;
+            ctx.out << detail::FormatDouble(value, buffer);
         }
 
         template <>
@@ -337,7 +585,7 @@ namespace json {
                     out << ",\n"sv;
                 }
                 inner_ctx.PrintIndent();
-                PrintString(key, ctx.out);
+                detail::PrintString(key, ctx.out);
                 out << ": "sv;
                 PrintNode(node, inner_ctx);
             }
@@ -356,8 +604,20 @@ namespace json {
 
     }  // namespace
 
+    Document Load(std::string_view input) {
+        return Document{ Parser(input).LoadNode() };
+    }
+
     Document Load(std::istream& input) {
-        return Document{ LoadNode(input) };
+        return Load(std::string_view(detail::ReadAll(input)));
+    }
+
+    Document LoadStreaming(std::string_view input, const std::vector<std::string_view>& streamed_keys, const ElementHandler& handler) {
+        return Document{ Parser(input).LoadStreamingRoot(streamed_keys, handler) };
+    }
+
+    Document LoadStreaming(std::istream& input, const std::vector<std::string_view>& streamed_keys, const ElementHandler& handler) {
+        return LoadStreaming(std::string_view(detail::ReadAll(input)), streamed_keys, handler);
     }
 
     void Print(const Document& doc, std::ostream& output) {
@@ -1,15 +1,19 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
     class Node;
-    using Dict = std::map<std::string, Node>;
+    using Dict = std::map<std::string, Node, std::less<>>;  // поиск по string_view без создания строки
     using Array = std::vector<Node>;
 
     class ParsingError : public std::runtime_error {
@@ -18,7 +22,7 @@ namespace json {
     };
 
     class Node final
-        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+        : private std::variant<std::nullptr_t, Array, Dict, bool, int, int64_t, double, std::string> {
     public:
         using variant::variant;
         using Value = variant;
@@ -36,18 +40,30 @@ namespace json {
             return std::get<int>(*this);
         }
 
+        // любое целое: целые, не помещающиеся в int, хранятся как int64_t
+        bool IsInt64() const {
+            return IsInt() || std::holds_alternative<int64_t>(*this);
+        }
+        int64_t AsInt64() const {
+            using namespace std::literals;
+            if (!IsInt64()) {
+                throw std::logic_error("Not an int"s);
+            }
+            return IsInt() ? std::get<int>(*this) : std::get<int64_t>(*this);
+        }
+
         bool IsPureDouble() const {
             return std::holds_alternative<double>(*this);
         }
         bool IsDouble() const {
-            return IsInt() || IsPureDouble();
+            return IsInt64() || IsPureDouble();
         }
         double AsDouble() const {
             using namespace std::literals;
             if (!IsDouble()) {
                 throw std::logic_error("Not a double"s);
             }
-            return IsPureDouble() ? std::get<double>(*this) : AsInt();
+            return IsPureDouble() ? std::get<double>(*this) : AsInt64();
         }
 
         bool IsBool() const {
@@ -66,10 +82,11 @@ namespace json {
             return std::holds_alternative<std::nullptr_t>(*this);
         }
 
+        // As* временного узла (например, результата Builder::Build()) забирают содержимое, не копируя
         bool IsArray() const {
             return std::holds_alternative<Array>(*this);
         }
-        const Array& AsArray() const {
+        const Array& AsArray() const& {
             using namespace std::literals;
             if (!IsArray()) {
                 throw std::logic_error("Not an array"s);
@@ -77,11 +94,19 @@ namespace json {
 
             return std::get<Array>(*this);
         }
+        Array AsArray() && {
+            using namespace std::literals;
+            if (!IsArray()) {
+                throw std::logic_error("Not an array"s);
+            }
+
+            return std::get<Array>(std::move(*this));
+        }
 
         bool IsString() const {
             return std::holds_alternative<std::string>(*this);
         }
-        const std::string& AsString() const {
+        const std::string& AsString() const& {
             using namespace std::literals;
             if (!IsString()) {
                 throw std::logic_error("Not a string"s);
@@ -89,11 +114,19 @@ namespace json {
 
             return std::get<std::string>(*this);
         }
+        std::string AsString() && {
+            using namespace std::literals;
+            if (!IsString()) {
+                throw std::logic_error("Not a string"s);
+            }
+
+            return std::get<std::string>(std::move(*this));
+        }
 
         bool IsDict() const {
             return std::holds_alternative<Dict>(*this);
         }
-        const Dict& AsDict() const {
+        const Dict& AsDict() const& {
             using namespace std::literals;
             if (!IsDict()) {
                 throw std::logic_error("Not a dict"s);
@@ -101,6 +134,14 @@ namespace json {
 
             return std::get<Dict>(*this);
         }
+        Dict AsDict() && {
+            using namespace std::literals;
+            if (!IsDict()) {
+                throw std::logic_error("Not a dict"s);
+            }
+
+            return std::get<Dict>(std::move(*this));
+        }
 
         bool operator==(const Node& rhs) const {
             return GetValue() == rhs.GetValue();
@@ -140,8 +181,21 @@ namespace json {
         return !(lhs == rhs);
     }
 
+    // документ, целиком лежащий в памяти (например, в отображенном в память файле)
+    Document Load(std::string_view input);
+
+    // поток читается до конца, документ разбирается из памяти
     Document Load(std::istream& input);
 
+    // обработчик элемента массива при потоковом разборе: ключ корневого словаря и элемент
+    using ElementHandler = std::function<void(std::string_view key, Node element)>;
+
+    // Потоковый разбор: массивы корневого словаря под ключами streamed_keys остаются в документе пустыми,
+    // их элементы передаются в handler по мере разбора и после него освобождаются.
+    // Остальные ключи разбираются как в Load
+    Document LoadStreaming(std::string_view input, const std::vector<std::string_view>& streamed_keys, const ElementHandler& handler);
+    Document LoadStreaming(std::istream& input, const std::vector<std::string_view>& streamed_keys, const ElementHandler& handler);
+
     void Print(const Document& doc, std::ostream& output);
 
 }  // namespace json
\ No newline at end of file
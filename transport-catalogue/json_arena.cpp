@@ -0,0 +1,507 @@
+#include "json_arena.h"
+#include "json_internal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std::literals;
+
+namespace json::arena {
+
+    Arena::Arena(Arena&& other) noexcept
+        : blocks_(std::move(other.blocks_))
+        , block_size_(std::exchange(other.block_size_, 0))
+        , pos_(std::exchange(other.pos_, nullptr))
+        , end_(std::exchange(other.end_, nullptr))
+    {
+    }
+
+    Arena& Arena::operator=(Arena&& other) noexcept {
+        if (this != &other) {
+            blocks_ = std::move(other.blocks_);
+            block_size_ = std::exchange(other.block_size_, 0);
+            pos_ = std::exchange(other.pos_, nullptr);
+            end_ = std::exchange(other.end_, nullptr);
+        }
+        return *this;
+    }
+
+    void* Arena::Allocate(size_t size, size_t alignment) {
+        const auto align_up = [alignment](std::byte* pos) {
+            const uintptr_t address = reinterpret_cast<uintptr_t>(pos);
+            return pos + ((alignment - address % alignment) % alignment);
+        };
+
+        std::byte* begin = pos_ != nullptr ? align_up(pos_) : nullptr;
+        if (begin == nullptr || static_cast<size_t>(end_ - begin) < size) {
+            // блоки растут вдвое, чтобы их число оставалось логарифмическим от размера документа
+            block_size_ = std::max({ MIN_BLOCK_SIZE, block_size_ * 2, size + alignment });
+            blocks_.push_back(std::make_unique<std::byte[]>(block_size_));
+            pos_ = blocks_.back().get();
+            end_ = pos_ + block_size_;
+            begin = align_up(pos_);
+        }
+        pos_ = begin + size;
+        return begin;
+    }
+
+    void Arena::Reset() {
+        if (blocks_.empty()) {
+            return;
+        }
+        if (blocks_.size() > 1) {
+            std::unique_ptr<std::byte[]> last = std::move(blocks_.back());
+            blocks_.clear();
+            blocks_.push_back(std::move(last));
+        }
+        pos_ = blocks_.back().get();
+        end_ = pos_ + block_size_;
+    }
+
+    Value::Value(bool value)
+        : type_(Type::BOOL)
+    {
+        bool_ = value;
+    }
+
+    Value::Value(int value)
+        : type_(Type::INT)
+    {
+        int_ = value;
+    }
+
+    Value::Value(int64_t value)
+        : type_(Type::INT64)
+    {
+        int64_ = value;
+    }
+
+    Value::Value(double value)
+        : type_(Type::DOUBLE)
+    {
+        double_ = value;
+    }
+
+    Value Value::String(std::string_view value) {
+        Value result;
+        result.type_ = Type::STRING;
+        result.size_ = static_cast<uint32_t>(value.size());
+        result.chars_ = value.data();
+        return result;
+    }
+
+    Value Value::Array(ArrayView items) {
+        Value result;
+        result.type_ = Type::ARRAY;
+        result.size_ = static_cast<uint32_t>(items.size());
+        result.items_ = items.begin();
+        return result;
+    }
+
+    Value Value::Dict(DictView members) {
+        Value result;
+        result.type_ = Type::DICT;
+        result.size_ = static_cast<uint32_t>(members.size());
+        result.members_ = members.begin();
+        return result;
+    }
+
+    bool Value::AsBool() const {
+        if (!IsBool()) {
+            throw std::logic_error("Not a bool"s);
+        }
+        return bool_;
+    }
+
+    int Value::AsInt() const {
+        if (!IsInt()) {
+            throw std::logic_error("Not an int"s);
+        }
+        return int_;
+    }
+
+    int64_t Value::AsInt64() const {
+        if (!IsInt64()) {
+            throw std::logic_error("Not an int"s);
+        }
+        return IsInt() ? int_ : int64_;
+    }
+
+    double Value::AsDouble() const {
+        if (!IsDouble()) {
+            throw std::logic_error("Not a double"s);
+        }
+        return IsPureDouble() ? double_ : AsInt64();
+    }
+
+    std::string_view Value::AsString() const {
+        if (!IsString()) {
+            throw std::logic_error("Not a string"s);
+        }
+        return { chars_, size_ };
+    }
+
+    ArrayView Value::AsArray() const {
+        if (!IsArray()) {
+            throw std::logic_error("Not an array"s);
+        }
+        return { items_, size_ };
+    }
+
+    DictView Value::AsDict() const {
+        if (!IsDict()) {
+            throw std::logic_error("Not a dict"s);
+        }
+        return { members_, size_ };
+    }
+
+    const Value& ArrayView::at(size_t index) const {
+        if (index >= size_) {
+            throw std::out_of_range("Array index "s + std::to_string(index) + " is out of range"s);
+        }
+        return items_[index];
+    }
+
+    const Value* DictView::Find(std::string_view key) const {
+        const Member* it = std::lower_bound(begin(), end(), key, [](const Member& member, std::string_view key) {
+            return member.key < key;
+            });
+        return it != end() && it->key == key ? &it->value : nullptr;
+    }
+
+    const Value& DictView::at(std::string_view key) const {
+        const Value* value = Find(key);
+        if (value == nullptr) {
+            throw std::out_of_range("Key '"s + std::string(key) + "' not found"s);
+        }
+        return *value;
+    }
+
+    std::optional<std::string_view> Document::FindDeferred(std::string_view key) const {
+        const Value* value = deferred_.Find(key);
+        if (value == nullptr) {
+            return std::nullopt;
+        }
+        return value->AsString();
+    }
+
+    Value Copy(const Value& value, Arena& arena) {
+        const auto copy_string = [&arena](std::string_view value) -> std::string_view {
+            char* chars = arena.AllocateArray<char>(value.size());
+            std::memcpy(chars, value.data(), value.size());
+            return { chars, value.size() };
+        };
+
+        switch (value.GetType()) {
+        case Value::Type::STRING:
+            return Value::String(copy_string(value.AsString()));
+        case Value::Type::ARRAY: {
+            const ArrayView items = value.AsArray();
+            Value* copied = arena.AllocateArray<Value>(items.size());
+            for (size_t i = 0; i < items.size(); ++i) {
+                copied[i] = Copy(items[i], arena);
+            }
+            return Value::Array({ copied, items.size() });
+        }
+        case Value::Type::DICT: {
+            // пары уже отсортированы по ключу и копируются в том же порядке
+            const DictView members = value.AsDict();
+            Member* copied = arena.AllocateArray<Member>(members.size());
+            for (size_t i = 0; i < members.size(); ++i) {
+                copied[i] = { copy_string(members.begin()[i].key), Copy(members.begin()[i].value, arena) };
+            }
+            return Value::Dict({ copied, members.size() });
+        }
+        default:
+            return value;
+        }
+    }
+
+    namespace {
+
+        // Разбор в узлы арены. Элементы массивов и пары словарей, пока контейнер не закрыт,
+        // копятся в общих стеках и затем одним куском переносятся в арену
+        class Parser : private detail::Scanner {
+        public:
+            Parser(std::string_view input, Arena& arena)
+                : Scanner(input)
+                , arena_(&arena) {
+            }
+
+            Value LoadNode();
+
+            Value LoadStreamingRoot(const std::vector<std::string_view>& streamed_keys,
+                                    const ElementHandler& handler,
+                                    const std::vector<std::string_view>& deferred_keys);
+
+            // значения, отложенные при разборе корня, в арене документа
+            DictView StoreDeferred();
+
+        private:
+            Arena* arena_;
+            Arena element_arena_;  // элементы потоковых массивов
+            std::vector<Value> items_;
+            std::vector<Member> members_;
+            std::string string_;  // буфер строк с экранированием
+
+            const std::vector<std::string_view>* streamed_keys_ = nullptr;
+            const ElementHandler* handler_ = nullptr;
+            const std::vector<std::string_view>* deferred_keys_ = nullptr;
+            std::vector<Member> deferred_;
+
+            static uint32_t CheckSize(size_t size) {
+                if (size > std::numeric_limits<uint32_t>::max()) {
+                    throw ParsingError("Value is too large"s);
+                }
+                return static_cast<uint32_t>(size);
+            }
+
+            std::string_view CopyString(std::string_view value) {
+                CheckSize(value.size());
+                char* chars = arena_->AllocateArray<char>(value.size());
+                std::memcpy(chars, value.data(), value.size());
+                return { chars, value.size() };
+            }
+
+            // пары отсортированы по ключу и перенесены в арену; повтор ключа - ошибка
+            DictView StoreMembers(size_t base, std::vector<Member>& members);
+
+            Value LoadArray();
+            Value LoadDict(bool is_streaming_root = false);
+        };
+
+        Value Parser::LoadArray() {
+            const size_t base = items_.size();
+            LoadElements([this] {
+                const Value item = LoadNode();
+                items_.push_back(item);
+                });
+
+            const size_t size = CheckSize(items_.size() - base);
+            Value* items = arena_->AllocateArray<Value>(size);
+            std::copy(items_.begin() + base, items_.end(), items);
+            items_.resize(base);
+            return Value::Array({ items, size });
+        }
+
+        Value Parser::LoadDict(bool is_streaming_root) {
+            const size_t base = members_.size();
+            LoadMembers([&](std::string_view key_view) {
+                // ключ копируется в арену документа до разбора значения, которое может переиспользовать его буфер
+                const std::string_view key = CopyString(key_view);
+                if (is_streaming_root
+                    && std::find(deferred_keys_->begin(), deferred_keys_->end(), key) != deferred_keys_->end()) {
+                    // текст значения копируется в арену документа, сам входной текст документ не хранит
+                    deferred_.push_back({ key, Value::String(CopyString(SkipValue())) });
+                    return;
+                }
+                if (is_streaming_root
+                    && std::find(streamed_keys_->begin(), streamed_keys_->end(), key) != streamed_keys_->end()) {
+                    SkipSpaces();
+                    if (Peek() == '[') {
+                        char bracket;
+                        ReadNonSpace(bracket);
+                        Arena* document_arena = std::exchange(arena_, &element_arena_);
+                        LoadElements([this, &key] {
+                            (*handler_)(key, LoadNode());
+                            element_arena_.Reset();
+                            });
+                        arena_ = document_arena;
+                        members_.push_back({ key, Value::Array({}) });
+                        return;
+                    }
+                }
+                const Value value = LoadNode();
+                members_.push_back({ key, value });
+                });
+
+            return Value::Dict(StoreMembers(base, members_));
+        }
+
+        DictView Parser::StoreMembers(size_t base, std::vector<Member>& members) {
+            const auto first = members.begin() + base;
+            std::stable_sort(first, members.end(), [](const Member& lhs, const Member& rhs) {
+                return lhs.key < rhs.key;
+                });
+            const auto duplicate = std::adjacent_find(first, members.end(), [](const Member& lhs, const Member& rhs) {
+                return lhs.key == rhs.key;
+                });
+            if (duplicate != members.end()) {
+                throw ParsingError("Duplicate key '"s + std::string(duplicate->key) + "' have been found");
+            }
+
+            const size_t size = CheckSize(members.size() - base);
+            Member* stored = arena_->AllocateArray<Member>(size);
+            std::copy(first, members.end(), stored);
+            members.resize(base);
+            return { stored, size };
+        }
+
+        DictView Parser::StoreDeferred() {
+            return StoreMembers(0, deferred_);
+        }
+
+        Value Parser::LoadStreamingRoot(const std::vector<std::string_view>& streamed_keys,
+                                        const ElementHandler& handler,
+                                        const std::vector<std::string_view>& deferred_keys) {
+            streamed_keys_ = &streamed_keys;
+            handler_ = &handler;
+            deferred_keys_ = &deferred_keys;
+
+            SkipSpaces();
+            if (Peek() != '{') {
+                // не словарь разбирается как обычно
+                return LoadNode();
+            }
+            char brace;
+            ReadNonSpace(brace);
+            return LoadDict(true);
+        }
+
+        Value Parser::LoadNode() {
+            char c;
+            if (!ReadNonSpace(c)) {
+                throw ParsingError("Unexpected EOF"s);
+            }
+            switch (c) {
+            case '[':
+                return LoadArray();
+            case '{':
+                return LoadDict();
+            case '"':
+                return Value::String(CopyString(LoadString(string_)));
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                Unread();
+                return Value(LoadBool());
+            case 'n':
+                Unread();
+                LoadNull();
+                return Value();
+            default:
+                Unread();
+                return std::visit([](auto number) {
+                    return Value(number);
+                    }, LoadNumber());
+            }
+        }
+
+        struct PrintContext {
+            std::ostream& out;
+            int indent_step = 4;
+            int indent = 0;
+
+            void PrintIndent() const {
+                for (int i = 0; i < indent; ++i) {
+                    out.put(' ');
+                }
+            }
+
+            PrintContext Indented() const {
+                return { out, indent_step, indent_step + indent };
+            }
+        };
+
+        void PrintValue(const Value& value, const PrintContext& ctx) {
+            std::ostream& out = ctx.out;
+            switch (value.GetType()) {
+            case Value::Type::NULL_VALUE:
+                out << "null"sv;
+                break;
+            case Value::Type::BOOL:
+                out << (value.AsBool() ? "true"sv : "false"sv);
+                break;
+            case Value::Type::INT:
+                [[fallthrough]];
+            case Value::Type::INT64: {
+                detail::NumberBuffer buffer;
+                out << detail::FormatInt(value.AsInt64(), buffer);
+                break;
+            }
+            case Value::Type::DOUBLE: {
+                detail::NumberBuffer buffer;
+                out << detail::FormatDouble(value.AsDouble(), buffer);
+                break;
+            }
+            case Value::Type::STRING:
+                detail::PrintString(value.AsString(), out);
+                break;
+            case Value::Type::ARRAY: {
+                out << "[\n"sv;
+                bool first = true;
+                const auto inner_ctx = ctx.Indented();
+                for (const Value& item : value.AsArray()) {
+                    if (!first) {
+                        out << ",\n"sv;
+                    }
+                    first = false;
+                    inner_ctx.PrintIndent();
+                    PrintValue(item, inner_ctx);
+                }
+                out.put('\n');
+                ctx.PrintIndent();
+                out.put(']');
+                break;
+            }
+            case Value::Type::DICT: {
+                out << "{\n"sv;
+                bool first = true;
+                const auto inner_ctx = ctx.Indented();
+                for (const auto& [key, item] : value.AsDict()) {
+                    if (!first) {
+                        out << ",\n"sv;
+                    }
+                    first = false;
+                    inner_ctx.PrintIndent();
+                    detail::PrintString(key, out);
+                    out << ": "sv;
+                    PrintValue(item, inner_ctx);
+                }
+                out.put('\n');
+                ctx.PrintIndent();
+                out.put('}');
+                break;
+            }
+            }
+        }
+
+    }  // namespace
+
+    Document Load(std::string_view input) {
+        Arena arena;
+        Value root = Parser(input, arena).LoadNode();
+        return Document(std::move(arena), root);
+    }
+
+    Document Load(std::istream& input) {
+        return Load(std::string_view(detail::ReadAll(input)));
+    }
+
+    Document LoadStreaming(std::string_view input,
+                           const std::vector<std::string_view>& streamed_keys,
+                           const ElementHandler& handler,
+                           const std::vector<std::string_view>& deferred_keys) {
+        Arena arena;
+        Parser parser(input, arena);
+        const Value root = parser.LoadStreamingRoot(streamed_keys, handler, deferred_keys);
+        const DictView deferred = parser.StoreDeferred();
+        return Document(std::move(arena), root, deferred);
+    }
+
+    Document LoadStreaming(std::istream& input,
+                           const std::vector<std::string_view>& streamed_keys,
+                           const ElementHandler& handler,
+                           const std::vector<std::string_view>& deferred_keys) {
+        return LoadStreaming(std::string_view(detail::ReadAll(input)), streamed_keys, handler, deferred_keys);
+    }
+
+    void Print(const Value& value, std::ostream& output) {
+        PrintValue(value, PrintContext{ output });
+    }
+
+}  // namespace json::arena
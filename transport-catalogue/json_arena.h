@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+// Документ JSON только для чтения, все узлы, строки и массивы которого лежат в арене документа:
+// построение и освобождение большого документа стоят нескольких выделений памяти.
+// Словари хранятся как отсортированные по ключу массивы пар с двоичным поиском.
+// Формат разбора и ошибки те же, что у json::Load, кроме повтора ключа: он обнаруживается
+// после разбора всего словаря
+namespace json::arena {
+
+    // Память блоками; освобождается вся сразу
+    class Arena {
+    public:
+        Arena() = default;
+
+        Arena(Arena&& other) noexcept;
+        Arena& operator=(Arena&& other) noexcept;
+
+        void* Allocate(size_t size, size_t alignment);
+
+        template <typename T>
+        T* AllocateArray(size_t count) {
+            return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        // освобождает все выделенное, последний (самый большой) блок остается для следующих выделений
+        void Reset();
+
+    private:
+        static constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<std::byte[]>> blocks_;
+        size_t block_size_ = 0;  // размер последнего блока
+        std::byte* pos_ = nullptr;
+        std::byte* end_ = nullptr;
+    };
+
+    class ArrayView;
+    class DictView;
+    struct Member;
+
+    // Узел документа (16 байт). Строки, элементы и пары не принадлежат узлу:
+    // память, на которую он указывает, должна жить дольше него
+    class Value {
+    public:
+        enum class Type : uint8_t {
+            NULL_VALUE,
+            BOOL,
+            INT,
+            INT64,
+            DOUBLE,
+            STRING,
+            ARRAY,
+            DICT
+        };
+
+        Value() = default;
+        explicit Value(bool value);
+        explicit Value(int value);
+        explicit Value(int64_t value);
+        explicit Value(double value);
+
+        static Value String(std::string_view value);
+        static Value Array(ArrayView items);
+        static Value Dict(DictView members);
+
+        Type GetType() const {
+            return type_;
+        }
+
+        bool IsNull() const {
+            return type_ == Type::NULL_VALUE;
+        }
+        bool IsBool() const {
+            return type_ == Type::BOOL;
+        }
+        bool IsInt() const {
+            return type_ == Type::INT;
+        }
+        // любое целое: целые, не помещающиеся в int, хранятся как int64_t
+        bool IsInt64() const {
+            return IsInt() || type_ == Type::INT64;
+        }
+        bool IsPureDouble() const {
+            return type_ == Type::DOUBLE;
+        }
+        bool IsDouble() const {
+            return IsInt64() || IsPureDouble();
+        }
+        bool IsString() const {
+            return type_ == Type::STRING;
+        }
+        bool IsArray() const {
+            return type_ == Type::ARRAY;
+        }
+        bool IsDict() const {
+            return type_ == Type::DICT;
+        }
+
+        bool AsBool() const;
+        int AsInt() const;
+        int64_t AsInt64() const;
+        double AsDouble() const;
+        std::string_view AsString() const;
+        ArrayView AsArray() const;
+        DictView AsDict() const;
+
+    private:
+        Type type_ = Type::NULL_VALUE;
+        uint32_t size_ = 0;  // длина строки, число элементов или пар
+        union {
+            bool bool_;
+            int int_;
+            int64_t int64_;
+            double double_;
+            const char* chars_;
+            const Value* items_;
+            const Member* members_ = nullptr;
+        };
+    };
+
+    struct Member {
+        std::string_view key;
+        Value value;
+    };
+
+    class ArrayView {
+    public:
+        ArrayView() = default;
+        ArrayView(const Value* items, size_t size)
+            : items_(items)
+            , size_(size) {
+        }
+
+        const Value* begin() const {
+            return items_;
+        }
+        const Value* end() const {
+            return items_ + size_;
+        }
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        const Value& operator[](size_t index) const {
+            return items_[index];
+        }
+        const Value& at(size_t index) const;
+
+    private:
+        const Value* items_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    class DictView {
+    public:
+        DictView() = default;
+        DictView(const Member* members, size_t size)
+            : members_(members)
+            , size_(size) {
+        }
+
+        // пары по возрастанию ключа
+        const Member* begin() const {
+            return members_;
+        }
+        const Member* end() const {
+            return members_ + size_;
+        }
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        // значение по ключу или nullptr
+        const Value* Find(std::string_view key) const;
+        const Value& at(std::string_view key) const;
+        size_t count(std::string_view key) const {
+            return Find(key) != nullptr ? 1 : 0;
+        }
+
+    private:
+        const Member* members_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    class Document {
+    public:
+        Document() = default;
+        Document(Arena arena, Value root, DictView deferred = {})
+            : arena_(std::move(arena))
+            , root_(root)
+            , deferred_(deferred) {
+        }
+
+        const Value& GetRoot() const {
+            return root_;
+        }
+
+        // неразобранный текст значения, отложенного при потоковом разборе, или nullopt
+        std::optional<std::string_view> FindDeferred(std::string_view key) const;
+
+    private:
+        Arena arena_;
+        Value root_;
+        DictView deferred_;  // значения - строки с текстом отложенных значений
+    };
+
+    Document Load(std::string_view input);
+    Document Load(std::istream& input);
+
+    // копия значения со всем содержимым в арене arena, например элемента потокового массива,
+    // который нужен и после вызова обработчика
+    Value Copy(const Value& value, Arena& arena);
+
+    // обработчик элемента массива при потоковом разборе; element живет только во время вызова
+    using ElementHandler = std::function<void(std::string_view key, const Value& element)>;
+
+    // Потоковый разбор, как json::LoadStreaming: массивы корневого словаря под ключами streamed_keys
+    // остаются в документе пустыми, их элементы разбираются в отдельную арену, которая после
+    // каждого элемента переиспользуется.
+    // Значения корневого словаря под ключами deferred_keys не разбираются: в корень они не попадают,
+    // их текст доступен через Document::FindDeferred и разбирается отдельно, когда понадобится
+    Document LoadStreaming(std::string_view input,
+                           const std::vector<std::string_view>& streamed_keys,
+                           const ElementHandler& handler,
+                           const std::vector<std::string_view>& deferred_keys = {});
+    Document LoadStreaming(std::istream& input,
+                           const std::vector<std::string_view>& streamed_keys,
+                           const ElementHandler& handler,
+                           const std::vector<std::string_view>& deferred_keys = {});
+
+    // вывод в том же формате, что json::Print
+    void Print(const Value& value, std::ostream& output);
+
+}  // namespace json::arena
@@ -32,8 +32,8 @@ namespace json {
         return BaseContext{ *this };
     }
 
-    Builder::BaseContext Builder::Value(Node::Value value) {
-        AddObject(std::move(value), /* one_shot */ true);
+    Builder::BaseContext Builder::Value(Node value) {
+        AddObject(std::move(value.GetValue()), /* one_shot */ true);
         return *this;
     }
 
@@ -42,8 +42,10 @@ namespace json {
         return BaseContext{ *this };
     }
 
-    Builder::ArrayItemContext Builder::StartArray() {
-        AddObject(Array{}, /* one_shot */ false);
+    Builder::ArrayItemContext Builder::StartArray(size_t capacity) {
+        Array array;
+        array.reserve(capacity);
+        AddObject(std::move(array), /* one_shot */ false);
         return BaseContext{ *this };
     }
 
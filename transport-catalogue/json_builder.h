@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include "json.h"
@@ -15,11 +16,14 @@ namespace json {
 
     public:
         Builder();
+        // готовый узел отдается перемещением, без копирования дерева
         Node Build();
         DictValueContext Key(std::string key);
-        BaseContext Value(Node::Value value);
+        // узел, в том числе результат другого Builder, переносится без копирования
+        BaseContext Value(Node value);
         DictItemContext StartDict();
-        ArrayItemContext StartArray();
+        // capacity - ожидаемое число элементов, память под них выделяется сразу
+        ArrayItemContext StartArray(size_t capacity = 0);
         BaseContext EndDict();
         BaseContext EndArray();
 
@@ -48,14 +52,14 @@ namespace json {
             DictValueContext Key(std::string key) {
                 return builder_.Key(std::move(key));
             }
-            BaseContext Value(Node::Value value) {
+            BaseContext Value(Node value) {
                 return builder_.Value(std::move(value));
             }
             DictItemContext StartDict() {
                 return builder_.StartDict();
             }
-            ArrayItemContext StartArray() {
-                return builder_.StartArray();
+            ArrayItemContext StartArray(size_t capacity = 0) {
+                return builder_.StartArray(capacity);
             }
             BaseContext EndDict() {
                 return builder_.EndDict();
@@ -70,7 +74,7 @@ namespace json {
         class DictValueContext : public BaseContext {
         public:
             DictValueContext(BaseContext base) : BaseContext(base) {}
-            DictItemContext Value(Node::Value value) { return BaseContext::Value(std::move(value)); }
+            DictItemContext Value(Node value) { return BaseContext::Value(std::move(value)); }
             Node Build() = delete;
             DictValueContext Key(std::string key) = delete;
             BaseContext EndDict() = delete;
@@ -81,16 +85,16 @@ namespace json {
         public:
             DictItemContext(BaseContext base) : BaseContext(base) {}
             Node Build() = delete;
-            BaseContext Value(Node::Value value) = delete;
+            BaseContext Value(Node value) = delete;
             BaseContext EndArray() = delete;
             DictItemContext StartDict() = delete;
-            ArrayItemContext StartArray() = delete;
+            ArrayItemContext StartArray(size_t capacity = 0) = delete;
         };
 
         class ArrayItemContext : public BaseContext {
         public:
             ArrayItemContext(BaseContext base) : BaseContext(base) {}
-            ArrayItemContext Value(Node::Value value) { return BaseContext::Value(std::move(value)); }
+            ArrayItemContext Value(Node value) { return BaseContext::Value(std::move(value)); }
             Node Build() = delete;
             DictValueContext Key(std::string key) = delete;
             BaseContext EndDict() = delete;
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "json.h"
+
+// Общая часть разбора и вывода для json::Document и json::arena::Document.
+// Не предназначена для использования вне реализации json
+namespace json::detail {
+
+    // Лексический разбор документа, целиком лежащего в памяти. Порядок разбора и сообщения
+    // об ошибках те же, что были у разбора из потока посимвольно.
+    // Пробелы и обычные символы строк пропускаются блоками по 16 байт (SSE2), без SSE2 - по одному
+    class Scanner {
+    public:
+        explicit Scanner(std::string_view input)
+            : input_(input) {
+        }
+
+        // следующий символ как unsigned char или EOF, как istream::peek
+        int Peek() const {
+            return pos_ < input_.size() ? static_cast<unsigned char>(input_[pos_]) : EOF;
+        }
+
+        void SkipSpaces();
+
+        // аналог input >> c: пропускает пробельные символы и читает следующий; при конце данных c не меняется
+        bool ReadNonSpace(char& c) {
+            SkipSpaces();
+            if (pos_ == input_.size()) {
+                return false;
+            }
+            c = input_[pos_++];
+            return true;
+        }
+
+        // возвращает прочитанный символ обратно, как istream::putback
+        void Unread() {
+            --pos_;
+        }
+
+        // Строка после открывающей кавычки. Строка без экранирования - кусок входных данных,
+        // иначе она раскодируется в buffer (прежнее содержимое стирается)
+        std::string_view LoadString(std::string& buffer);
+
+        // Пропускает значение целиком, проверяя только парность скобок и кавычек; возвращает его текст.
+        // Остальные ошибки обнаружатся, когда текст будет разобран
+        std::string_view SkipValue();
+
+        // целое, помещающееся в int, иначе целое в 64 бита, иначе double
+        std::variant<int, int64_t, double> LoadNumber();
+        bool LoadBool();
+        void LoadNull();
+
+        // Элементы массива после '['. load_element() разбирает один элемент
+        template <typename LoadElement>
+        void LoadElements(LoadElement load_element);
+
+        // Пары словаря после '{'. load_member(key) разбирает значение ключа key, когда ':' после
+        // ключа уже прочитан. key действителен только до разбора значения: ключи вложенных словарей
+        // раскодируются в тот же буфер
+        template <typename LoadMember>
+        void LoadMembers(LoadMember load_member);
+
+    private:
+        std::string_view input_;
+        size_t pos_ = 0;
+        std::string key_buffer_;
+
+        static bool IsSpace(char c) {
+            return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+        }
+
+        // позиция первого из символов ", \, \n, \r, начиная с pos_, или конец данных
+        size_t FindStringSpecial() const;
+
+        std::string_view LoadLiteral();
+
+        // пропускает строку после открывающей кавычки
+        void SkipString();
+    };
+
+    template <typename LoadElement>
+    void Scanner::LoadElements(LoadElement load_element) {
+        using namespace std::literals;
+
+        bool closed = false;
+        for (char c; ReadNonSpace(c);) {
+            if (c == ']') {
+                closed = true;
+                break;
+            }
+            if (c != ',') {
+                Unread();
+            }
+            load_element();
+        }
+        if (!closed) {
+            throw ParsingError("Array parsing error"s);
+        }
+    }
+
+    template <typename LoadMember>
+    void Scanner::LoadMembers(LoadMember load_member) {
+        using namespace std::literals;
+
+        bool closed = false;
+        for (char c; ReadNonSpace(c);) {
+            if (c == '}') {
+                closed = true;
+                break;
+            }
+            if (c == '"') {
+                const std::string_view key = LoadString(key_buffer_);
+                if (ReadNonSpace(c) && c == ':') {
+                    load_member(key);
+                }
+                else {
+                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+            }
+            else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        if (!closed) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+    }
+
+    // Символы value с экранированием ", \, \n, \r, \t, без кавычек. В out должно быть место
+    // для 2 * value.size() символов; возвращает конец записанного.
+    // Блоки по 16 байт (SSE2) копируются целиком, экранируются только отдельные символы
+    char* EscapeChars(std::string_view value, char* out);
+
+    // строка в кавычках с экранированием
+    void PrintString(std::string_view value, std::ostream& out);
+
+    // Запись чисел без учета локали в buffer. double - в кратчайшей записи,
+    // которая читается обратно в то же значение
+    using NumberBuffer = std::array<char, 32>;
+    std::string_view FormatInt(int64_t value, NumberBuffer& buffer);
+    std::string_view FormatDouble(double value, NumberBuffer& buffer);
+
+    // поток читается до конца
+    std::string ReadAll(std::istream& input);
+
+}  // namespace json::detail
@@ -2,234 +2,508 @@
 #include "transport_catalogue.h"
 #include "geo.h"
 #include "json.h"
-#include "json_builder.h"
+#include "json_arena.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
 namespace json_reader {
 
-    // вспомогательный метод для вывода маршрутов по запросу Stop, в формате json
-    json::Dict JsonReader::StopResponseToJsonDict(int request_id, const std::optional<domain::StopInfo>& stop_info) const {
-        
-        json::Builder stop_build;
-
-        stop_build.StartDict();
-        if (stop_info) {
-            stop_build.Key("buses"s).StartArray();
-            for (const auto& bus : stop_info->buses) {
-                stop_build.Value(std::string(bus));
+    namespace {
+
+        // меньшие части base_requests не стоят запуска отдельного потока
+        const size_t BASE_REQUESTS_PER_CHUNK = 4096;
+
+        // Число из настроек в пределах [1, max_value]. Читается как int: отрицательное значение,
+        // приведенное к size_t, стало бы огромным и прошло бы проверку на ноль
+        size_t ParseCount(const json::arena::Value& value, std::string_view name,
+                          size_t max_value = std::numeric_limits<int>::max()) {
+            const int count = value.AsInt();
+            if (count < 1) {
+                throw std::invalid_argument(std::string(name) + " should be positive"s);
+            }
+            if (static_cast<size_t>(count) > max_value) {
+                throw std::invalid_argument(std::string(name) + " should not exceed "s + std::to_string(max_value));
             }
-            stop_build.EndArray();
+            return static_cast<size_t>(count);
         }
-        else {
-            stop_build.Key("error_message"s).Value("not found"s);
+
+    }  // namespace
+
+    JsonReader::JsonReader(std::istream& in)
+        : in_(in)
+        , json_document_(json::arena::LoadStreaming(in_, { "base_requests"sv }, [this](std::string_view, const json::arena::Value& request) {
+            AddBaseRequest(request);
+            }, { "render_settings"sv, "routing_settings"sv, "serialization_settings"sv,
+                 "sharding_settings"sv, "output_settings"sv, "worker_settings"sv }))
+    {
+        FinishBaseRequests();
+    }
+
+    const json::arena::Value* JsonReader::FindSection(std::string_view key) const {
+        if (const auto it = sections_.find(key); it != sections_.end()) {
+            return &it->second.GetRoot();
+        }
+        if (const auto text = json_document_.FindDeferred(key)) {
+            // FindSection вызывается со строковыми литералами, ключ кэша живет всю программу
+            return &sections_.emplace(key, json::arena::Load(*text)).first->second.GetRoot();
         }
-        stop_build.Key("request_id"s).Value(request_id);
-        stop_build.EndDict();
+        return json_document_.GetRoot().AsDict().Find(key);
+    }
 
-        return stop_build.Build().AsDict();
+    const json::arena::Value& JsonReader::GetSection(std::string_view key) const {
+        const json::arena::Value* section = FindSection(key);
+        if (section == nullptr) {
+            throw std::out_of_range("Key '"s + std::string(key) + "' not found"s);
+        }
+        return *section;
     }
 
-    // вспомогательный метод для вывода информации о маршруте по запросу Bus, в формате json
-    json::Dict JsonReader::BusResponseToJsonDict(int request_id, const std::optional<domain::BusInfo>& bus_info) const {
-        
-        json::Builder bus_build;
+    // Ответы пишутся сразу в json::Writer, ключи каждого словаря - по алфавиту,
+    // в том порядке, в каком их выводит json::Print
+
+    // ответ на запрос любого типа, объекта которого нет в каталоге
+    void JsonReader::WriteNotFoundResponse(int request_id, json::Writer& writer) const {
+        writer.StartDict()
+              .Key("error_message"sv).Value("not found"sv)
+              .Key("request_id"sv).Value(request_id)
+              .EndDict();
+    }
 
-        bus_build.StartDict();
-        if (bus_info) {
-            bus_build.Key("curvature"s).Value(bus_info->curvature)
-                     .Key("route_length"s).Value(bus_info->route_length)
-                     .Key("stop_count"s).Value((int)bus_info->stops)
-                     .Key("unique_stop_count"s).Value((int)bus_info->uniq_stops);
+    // вспомогательный метод для вывода маршрутов по запросу Stop, в формате json
+    void JsonReader::WriteStopResponse(int request_id, const domain::StopInfo& stop_info, json::Writer& writer) const {
+        writer.StartDict()
+              .Key("buses"sv).StartArray();
+        for (const domain::Bus* bus : stop_info.buses) {
+            writer.Value(bus->name);
         }
-        else {
-            bus_build.Key("error_message"s).Value("not found"s);
+        writer.EndArray()
+              .Key("request_id"sv).Value(request_id)
+              .EndDict();
+    }
+
+    // вспомогательный метод для вывода информации о маршруте по запросу Bus, в формате json
+    void JsonReader::WriteBusResponse(int request_id, const domain::BusInfo& bus_info, json::Writer& writer) const {
+        writer.StartDict()
+              .Key("curvature"sv).Value(bus_info.curvature)
+              .Key("request_id"sv).Value(request_id)
+              .Key("route_length"sv).Value(bus_info.route_length)
+              .Key("stop_count"sv).Value((int)bus_info.stops)
+              .Key("unique_stop_count"sv).Value((int)bus_info.uniq_stops)
+              .EndDict();
+    }
+
+    // вспомогательный метод для вывода автобусов без пересадки по запросу Direct
+    void JsonReader::WriteDirectResponse(int request_id, const std::vector<domain::DirectBus>& direct_buses, json::Writer& writer) const {
+        writer.StartDict()
+              .Key("buses"sv).StartArray();
+        for (const auto& [bus, span_count] : direct_buses) {
+            writer.StartDict()
+                  .Key("bus"sv).Value(bus->name)
+                  .Key("span_count"sv).Value(static_cast<int>(span_count))
+                  .EndDict();
         }
-        bus_build.Key("request_id"s).Value(request_id);
-        bus_build.EndDict();
+        writer.EndArray()
+              .Key("request_id"sv).Value(request_id)
+              .EndDict();
+    }
 
-        return bus_build.Build().AsDict();
+    // вспомогательный метод для вывода ближайших остановок по запросу Nearest
+    void JsonReader::WriteNearestResponse(int request_id, const std::vector<transport::NearestStop>& nearest_stops, json::Writer& writer) const {
+        writer.StartDict()
+              .Key("request_id"sv).Value(request_id)
+              .Key("stops"sv).StartArray();
+        for (const auto& [stop, distance] : nearest_stops) {
+            writer.StartDict()
+                  .Key("distance"sv).Value(distance)
+                  .Key("stop_name"sv).Value(stop->name)
+                  .EndDict();
+        }
+        writer.EndArray()
+              .EndDict();
     }
 
     // вспомогательный метод для вывода svg рендера по запросу Map
-    json::Dict JsonReader::MapResponseToJsonDict(int request_id, const svg::Document& render_doc) const {
-        
-        json::Builder map_build;
-
+    void JsonReader::WriteMapResponse(int request_id, const svg::Document& render_doc, json::Writer& writer) const {
         std::ostringstream out;
         render_doc.Render(out);
-        std::string svg_out = out.str();
 
-        map_build.StartDict()
-                 .Key("map"s).Value(std::move(svg_out))
-                 .Key("request_id"s).Value(request_id)
-                 .EndDict();
-
-        return map_build.Build().AsDict();
+        writer.StartDict()
+              .Key("map"sv).Value(out.str())
+              .Key("request_id"sv).Value(request_id)
+              .EndDict();
     }
 
     // вспомогательный метод для вывода информации по запросу Route (выбор маршрута)
-    json::Dict JsonReader::RouteResponseToJsonDict(int request_id, 
-                                                   const std::optional<graph::Router<double>::RouteInfo>& routing,
-                                                   const graph::DirectedWeightedGraph<double>& graph) const {
-        json::Builder route_build;
-
+    void JsonReader::WriteRouteResponse(int request_id,
+                                        const std::optional<graph::Router<double>::RouteInfo>& routing,
+                                        const graph::DirectedWeightedGraph<double>& graph,
+                                        json::Writer& writer) const {
         if (!routing) {
-            route_build.StartDict()
-                       .Key("request_id"s).Value(request_id)
-                       .Key("error_message"s).Value("not found"s)
-                       .EndDict();
+            WriteNotFoundResponse(request_id, writer);
+            return;
+        }
+
+        // общее время считается при выводе частей маршрута и пишется после них
+        double time_route = 0.0;
+        writer.StartDict()
+              .Key("items"sv).StartArray();
+        for (auto& edge_id : routing.value().edges) {
+            const graph::Edge<double> edge = graph.GetEdge(edge_id);
+
+            if (edge.type == graph::EdgeType::WAIT) {
+                writer.StartDict()
+                      .Key("stop_name"sv).Value(edge.name)
+                      .Key("time"sv).Value(edge.weight)
+                      .Key("type"sv).Value("Wait"sv)
+                      .EndDict();
+            }
+            else if (edge.type == graph::EdgeType::WALK) {
+                // stop_name - остановка, до которой идем пешком
+                writer.StartDict()
+                      .Key("stop_name"sv).Value(edge.name)
+                      .Key("time"sv).Value(edge.weight)
+                      .Key("type"sv).Value("Walk"sv)
+                      .EndDict();
+            }
+            else {
+                writer.StartDict()
+                      .Key("bus"sv).Value(edge.name)
+                      .Key("span_count"sv).Value(static_cast<int>(edge.quality))
+                      .Key("time"sv).Value(edge.weight)
+                      .Key("type"sv).Value("Bus"sv)
+                      .EndDict();
+            }
+            time_route += edge.weight;
+        }
+        writer.EndArray()
+              .Key("request_id"sv).Value(request_id)
+              .Key("total_time"sv).Value(time_route)
+              .EndDict();
+    }
+
+    // разбор запроса и поиск его объектов по именам; вершины графа ищутся, только если есть запросы Route
+    std::optional<transport::StatRequest> JsonReader::CompileStatRequest(const json::arena::Value& request,
+                                                                         const transport::RequestHandler& rq) const {
+        using Type = transport::StatRequest::Type;
+
+        const auto& request_map = request.AsDict();
+        const std::string_view type = request_map.at("type"sv).AsString();
+
+        transport::StatRequest result;
+        result.id = request_map.at("id"sv).AsInt();
+
+        if (type == "Stop"sv) {
+            result.type = Type::STOP;
+            result.from = rq.FindStop(request_map.at("name"sv).AsString());
+            result.found = result.from != nullptr;
+        }
+        else if (type == "Bus"sv) {
+            result.type = Type::BUS;
+            result.bus = rq.FindBus(request_map.at("name"sv).AsString());
+            result.found = result.bus != nullptr;
+        }
+        else if (type == "Direct"sv) {
+            result.type = Type::DIRECT;
+            result.from = rq.FindStop(request_map.at("from"sv).AsString());
+            result.to = rq.FindStop(request_map.at("to"sv).AsString());
+            result.found = result.from != nullptr && result.to != nullptr;
+        }
+        else if (type == "Nearest"sv) {
+            result.type = Type::NEAREST;
+            result.center = { request_map.at("latitude"sv).AsDouble(), request_map.at("longitude"sv).AsDouble() };
+            // count читается как int: отрицательное значение, приведенное к size_t, вернуло бы все остановки
+            const int count = request_map.at("count"sv).AsInt();
+            if (count < 0) {
+                throw std::invalid_argument("Nearest count should not be negative"s);
+            }
+            if (static_cast<size_t>(count) > transport::StatRequest::MAX_NEAREST_COUNT) {
+                throw std::invalid_argument("Nearest count should not exceed "s
+                                            + std::to_string(transport::StatRequest::MAX_NEAREST_COUNT));
+            }
+            result.count = static_cast<size_t>(count);
+        }
+        else if (type == "Map"sv) {
+            result.type = Type::MAP;
+        }
+        else if (type == "Route"sv) {
+            result.type = Type::ROUTE;
+            const auto from = rq.FindRouteVertex(request_map.at("from"sv).AsString());
+            const auto to = rq.FindRouteVertex(request_map.at("to"sv).AsString());
+            result.found = from && to;
+            result.from_vertex = from.value_or(0);
+            result.to_vertex = to.value_or(0);
         }
         else {
-            json::Array arr_route;
-            double time_route = 0.0;
-            arr_route.reserve(routing.value().edges.size());
-
-            for (auto& edge_id : routing.value().edges) {
-                const graph::Edge<double> edge = graph.GetEdge(edge_id);
-
-                if (edge.quality == 0) {
-                    arr_route.emplace_back(json::Node(json::Builder{}
-                             .StartDict()
-                             .Key("stop_name"s).Value(edge.name)
-                             .Key("time"s).Value(edge.weight)
-                             .Key("type"s).Value("Wait"s)
-                             .EndDict().Build()));
-
-                    time_route += edge.weight;
-                }
-                else {
-                    arr_route.emplace_back(json::Node(json::Builder{}
-                             .StartDict()
-                             .Key("bus"s).Value(edge.name)
-                             .Key("span_count"s).Value(static_cast<int>(edge.quality))
-                             .Key("time"s).Value(edge.weight)
-                             .Key("type"s).Value("Bus"s)
-                             .EndDict().Build()));
-
-                    time_route += edge.weight;
-                }
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    std::vector<transport::StatRequest> JsonReader::CompileStatRequests(json::arena::ArrayView requests,
+                                                                        const transport::RequestHandler& rq) const {
+        std::vector<transport::StatRequest> result;
+        result.reserve(requests.size());
+        for (const auto& request : requests) {
+            if (auto compiled = CompileStatRequest(request, rq)) {
+                result.push_back(*compiled);
             }
+        }
+        return result;
+    }
+
+    // выполнение разобранного запроса и вывод ответа с помощью вспомогательных методов записи в json
+    void JsonReader::ResponseRequest(const transport::StatRequest& request, const transport::RequestHandler& rq, json::Writer& writer) const {
+        using Type = transport::StatRequest::Type;
+
+        if (!request.found) {
+            WriteNotFoundResponse(request.id, writer);
+            return;
+        }
 
-            route_build.StartDict()
-                       .Key("request_id"s).Value(request_id)
-                       .Key("total_time"s).Value(time_route)
-                       .Key("items"s).Value(arr_route)
-                       .EndDict();
+        switch (request.type) {
+        case Type::STOP:
+            WriteStopResponse(request.id, rq.GetBusesByStop(*request.from), writer);
+            break;
+        case Type::BUS:
+            WriteBusResponse(request.id, rq.GetBusInfo(*request.bus), writer);
+            break;
+        case Type::DIRECT:
+            WriteDirectResponse(request.id, rq.GetDirectBuses(*request.from, *request.to), writer);
+            break;
+        case Type::NEAREST:
+            rq.GetNearestStops(request.center, request.count, nearest_stops_);
+            WriteNearestResponse(request.id, nearest_stops_, writer);
+            break;
+        case Type::MAP:
+            WriteMapResponse(request.id, rq.RenderMap(), writer);
+            break;
+        case Type::ROUTE:
+            WriteRouteResponse(request.id, rq.GetOptimalRoute(request.from_vertex, request.to_vertex), rq.GetRouterGraph(), writer);
+            break;
         }
-        
-        return route_build.Build().AsDict();
     }
 
-    // обработка запросов к каталогу и вывод информации с помощью вспомогательных методов конвертации в json
+    bool JsonReader::ResponseRequest(const json::arena::Value& request, const transport::RequestHandler& rq, json::Writer& writer) const {
+        const auto compiled = CompileStatRequest(request, rq);
+        if (!compiled) {
+            return false;
+        }
+        ResponseRequest(*compiled, rq, writer);
+        return true;
+    }
+
     void JsonReader::ResponseRequests(std::ostream& os, const transport::RequestHandler& rq) const {
-        
-        json::Builder responses;
+        json::Writer writer(os, ParseOutputFormat());
+        ResponseRequests(GetStatRequests(), rq, writer);
+    }
 
-        responses.StartArray();
-        for (const auto& request : json_document_.GetRoot().AsDict().at("stat_requests"s).AsArray()) {
+    // Все запросы разбираются до выполнения, затем выполняются по порядку; ответ на каждый
+    // уходит в writer сразу, как только вычислен
+    void JsonReader::ResponseRequests(json::arena::ArrayView requests, const transport::RequestHandler& rq, json::Writer& writer) const {
+        const std::vector<transport::StatRequest> compiled = CompileStatRequests(requests, rq);
 
-            const auto& request_id = request.AsDict().at("id"s).AsInt();
+        writer.StartArray();
+        for (const transport::StatRequest& request : compiled) {
+            ResponseRequest(request, rq, writer);
+        }
+        writer.EndArray();
+    }
 
-            if (request.AsDict().at("type"s).AsString() == "Stop"sv) {
-                auto result = rq.GetBusesByStop(request.AsDict().at("name"s).AsString());
-                responses.Value(StopResponseToJsonDict(request_id, result));
-            }
+    json::arena::ArrayView JsonReader::GetStatRequests() const {
+        return GetSection("stat_requests"sv).AsArray();
+    }
 
-            else if (request.AsDict().at("type"s).AsString() == "Bus"sv) {
-                auto result = rq.GetBusInfo(request.AsDict().at("name"s).AsString());
-                responses.Value(BusResponseToJsonDict(request_id, result));
-            }
+    json::Writer::Format JsonReader::ParseOutputFormat() const {
+        const json::arena::Value* output_settings = FindSection("output_settings"sv);
+        if (output_settings == nullptr) {
+            return json::Writer::Format::PRETTY;
+        }
 
-            else if (request.AsDict().at("type"s).AsString() == "Map"sv) {
-                responses.Value(MapResponseToJsonDict(request_id, rq.RenderMap()));
-            }
+        const json::arena::Value* compact = output_settings->AsDict().Find("compact"sv);
+        return compact != nullptr && compact->AsBool() ? json::Writer::Format::COMPACT : json::Writer::Format::PRETTY;
+    }
 
-            else if (request.AsDict().at("type"s).AsString() == "Route"sv) {
-                const std::string_view stop_from = request.AsDict().at("from"s).AsString();
-                const std::string_view stop_to = request.AsDict().at("to"s).AsString();
-                const auto& routing = rq.GetOptimalRoute(stop_from, stop_to);
-                const auto& route_graph = rq.GetRouterGraph();
-                responses.Value(RouteResponseToJsonDict(request_id, routing, route_graph));
-            }
+    workers::WorkerPoolSettings JsonReader::ParseWorkerSettings() const {
+        workers::WorkerPoolSettings settings;
+
+        const json::arena::Value* worker_settings = FindSection("worker_settings"sv);
+        if (worker_settings == nullptr) {
+            return settings;
+        }
+
+        const auto ws_map = worker_settings->AsDict();
+        if (const json::arena::Value* worker_count = ws_map.Find("workers"sv)) {
+            settings.worker_count = ParseCount(*worker_count, "Worker count"sv, workers::WorkerPoolSettings::MAX_WORKER_COUNT);
+        }
+        if (const json::arena::Value* batch_size = ws_map.Find("batch_size"sv)) {
+            settings.batch_size = ParseCount(*batch_size, "Batch size"sv);
         }
 
-        responses.EndArray();
-        json::Print(json::Document(responses.Build()), os);
+        return settings;
     }
 
     // вспомогательный метод для заполнения каталога, забирает информацию об остановке
-    Stop JsonReader::ParseStopQuery(const json::Node& type_stop) const {
+    Stop JsonReader::ParseStopQuery(const json::arena::Value& type_stop) const {
         const auto& type_stop_map = type_stop.AsDict();
-        return Stop{ type_stop_map.at("name"s).AsString(),
-                        geo::Coordinates{type_stop_map.at("latitude"s).AsDouble(),
-                                         type_stop_map.at("longitude"s).AsDouble()} };
+        return Stop{ std::string(type_stop_map.at("name"sv).AsString()),
+                        geo::Coordinates{type_stop_map.at("latitude"sv).AsDouble(),
+                                         type_stop_map.at("longitude"sv).AsDouble()} };
     }
 
-    // вспомогательный метод для заполнения каталога, забирает информацию о дистанциях между остановками
-    void JsonReader::ParseStopQueryDistance(transport::TransportCatalogue& ts, const json::Node& type_stop) const {
-        const auto& type_stop_map = type_stop.AsDict();
-        for (const auto& [to_stop, dist_to_stop] : type_stop_map.at("road_distances"s).AsDict()) {
-            ts.AddStopPairDistances(ts.FindStop(type_stop_map.at("name"s).AsString()),
-                                    ts.FindStop(to_stop), dist_to_stop.AsInt());
+    size_t JsonReader::StopReferences::Intern(std::string_view stop_name) {
+        if (const auto it = name_ids.find(stop_name); it != name_ids.end()) {
+            return it->second;
         }
+        // разобранный запрос освобождается, поэтому имя копируется, один раз на имя
+        const std::string& name = names.emplace_back(stop_name);
+        name_ids.emplace(name, names.size() - 1);
+        return names.size() - 1;
+    }
 
+    // вспомогательный метод для заполнения каталога, запоминает дистанции между остановками
+    void JsonReader::ParseStopQueryDistance(StopReferences& refs, const json::arena::Value& type_stop) const {
+        const auto& type_stop_map = type_stop.AsDict();
+        const size_t from = refs.Intern(type_stop_map.at("name"sv).AsString());
+        for (const auto& [to_stop, dist_to_stop] : type_stop_map.at("road_distances"sv).AsDict()) {
+            refs.distances.push_back({ from, refs.Intern(to_stop), dist_to_stop.AsInt() });
+        }
     }
 
-    // вспомогательный метод для заполнения каталога, добавляет остановки в маршрут в соответствии с флагом is_roundtrip (кольцевой или нет)
-    Bus JsonReader::ParseBusQuery(const transport::TransportCatalogue& ts, const json::Node& node_bus) const {
+    // вспомогательный метод для заполнения каталога, запоминает маршрут в объявленном направлении,
+    // обратный путь некольцевого маршрута (is_roundtrip == false) каталог строит сам при обходе
+    void JsonReader::ParseBusQuery(StopReferences& refs, const json::arena::Value& node_bus) const {
         const auto& node_bus_map = node_bus.AsDict();
-        Bus bus;
-        bus.is_roundtrip = node_bus_map.at("is_roundtrip"s).AsBool();
-        bus.name = node_bus_map.at("name"s).AsString();
-        const auto& stops = node_bus_map.at("stops").AsArray();
+        const auto& stops = node_bus_map.at("stops"sv).AsArray();
 
-        // маршрут в прямом направлении
+        StopReferences::Route route{ std::string(node_bus_map.at("name"sv).AsString()), refs.route_stops.size(), 0,
+                                     node_bus_map.at("is_roundtrip"sv).AsBool() };
         for (const auto& stop : stops) {
-            bus.route.push_back(ts.FindStop(stop.AsString()));
+            refs.route_stops.push_back(refs.Intern(stop.AsString()));
+        }
+        route.stops_end = refs.route_stops.size();
+        refs.routes.push_back(route);
+    }
+
+    // запрос из base_requests, переданный при потоковом разборе документа: копируется в текущую часть,
+    // полная часть отдается потоку
+    void JsonReader::AddBaseRequest(const json::arena::Value& request) {
+        if (base_requests_.chunks.size() == base_requests_.dispatched) {
+            base_requests_.chunks.emplace_back().requests.reserve(BASE_REQUESTS_PER_CHUNK);
+        }
+        BaseRequestsChunk& chunk = base_requests_.chunks.back();
+        chunk.requests.push_back(json::arena::Copy(request, chunk.arena));
+        if (chunk.requests.size() == BASE_REQUESTS_PER_CHUNK) {
+            DispatchBaseRequestsChunk();
+        }
+    }
+
+    // Потоков с частями не больше, чем ядер: прежде чем отдать новую, дожидаемся самой старой.
+    // Так и память на неразобранные части ограничена
+    void JsonReader::DispatchBaseRequestsChunk() {
+        const size_t max_pending = std::max<size_t>(1, std::thread::hardware_concurrency());
+        if (base_requests_.pending.size() == max_pending) {
+            base_requests_.pending.front().get();
+            base_requests_.pending.pop_front();
         }
+        BaseRequestsChunk& chunk = base_requests_.chunks.back();
+        base_requests_.pending.push_back(std::async(std::launch::async, [this, &chunk] {
+            ParseBaseRequests(chunk);
+            }));
+        ++base_requests_.dispatched;
+    }
+
+    // последняя неполная часть разбирается в текущем потоке, затем дожидаемся остальных.
+    // Исключение из разбора части пробрасывается здесь, в порядке частей
+    void JsonReader::FinishBaseRequests() {
+        if (base_requests_.chunks.size() > base_requests_.dispatched) {
+            ParseBaseRequests(base_requests_.chunks.back());
+            ++base_requests_.dispatched;
+        }
+        while (!base_requests_.pending.empty()) {
+            base_requests_.pending.front().get();
+            base_requests_.pending.pop_front();
+        }
+    }
 
-        // если маршрут не кольцевой
-        if (!bus.is_roundtrip) {
-            // Добавляем остановки в обратном направлении
-            for (size_t i = stops.size() - 1; i > 1; --i) {
-                bus.route.push_back(ts.FindStop(stops[i - 1].AsString()));
+    // разбирает запросы части, каталог при этом не трогается
+    void JsonReader::ParseBaseRequests(BaseRequestsChunk& chunk) const {
+        for (const json::arena::Value& request : chunk.requests) {
+            const std::string_view type = request.AsDict().at("type"sv).AsString();
+            if (type == "Stop"sv) {
+                chunk.stops.push_back(ParseStopQuery(request));
+                ParseStopQueryDistance(chunk.refs, request);
+            }
+            else if (type == "Bus"sv) {
+                ParseBusQuery(chunk.refs, request);
             }
-            // Добавляем первую остановку
-            bus.route.push_back(ts.FindStop(stops[0].AsString()));
         }
+        chunk.requests = {};
+        chunk.arena = json::arena::Arena();
+    }
 
-        return bus;
+    // разрешает ссылки по именам, когда все остановки уже в каталоге
+    std::vector<const Stop*> JsonReader::ResolveStopReferences(const transport::TransportCatalogue& ts,
+                                                               const BaseRequestsChunk& chunk) const {
+        std::vector<const Stop*> resolved_stops;
+        resolved_stops.reserve(chunk.refs.names.size());
+        for (std::string_view name : chunk.refs.names) {
+            resolved_stops.push_back(ts.FindStop(name));
+        }
+        return resolved_stops;
     }
 
-    // с помощью вспомогательных методов заполняем транспортный каталог из json
+    // с помощью вспомогательных методов заполняем транспортный каталог из json.
+    // Запросы уже разобраны при чтении документа, в каталог они добавляются
+    // в порядке входных данных: остановки, затем дистанции, затем маршруты
     transport::TransportCatalogue JsonReader::TransportCatalogueFromJson() const {
+        // сами запросы в документе не хранятся, но раздел обязателен
+        GetSection("base_requests"sv);
+
         transport::TransportCatalogue ts;
-        for (const auto& request : json_document_.GetRoot().AsDict().at("base_requests"s).AsArray()) {
-            if (request.AsDict().at("type"s).AsString() == "Stop"sv) {
-                ts.AddStop(ParseStopQuery(request.AsDict()));
+
+        for (const BaseRequestsChunk& chunk : base_requests_.chunks) {
+            for (const Stop& stop : chunk.stops) {
+                ts.AddStop(Stop(stop));
             }
         }
 
-        for (const auto& request : json_document_.GetRoot().AsDict().at("base_requests"s).AsArray()) {
-            if (request.AsDict().at("type"s).AsString() == "Stop"sv) {
-                ParseStopQueryDistance(ts, request);
+        std::vector<std::vector<const Stop*>> resolved_stops;
+        resolved_stops.reserve(base_requests_.chunks.size());
+        for (const BaseRequestsChunk& chunk : base_requests_.chunks) {
+            resolved_stops.push_back(ResolveStopReferences(ts, chunk));
+        }
+
+        for (size_t i = 0; i < base_requests_.chunks.size(); ++i) {
+            for (const auto& [from, to, distance] : base_requests_.chunks[i].refs.distances) {
+                ts.AddStopPairDistances(resolved_stops[i][from], resolved_stops[i][to], distance);
             }
         }
 
-        for (const auto& request : json_document_.GetRoot().AsDict().at("base_requests"s).AsArray()) {
-            if (request.AsDict().at("type"s).AsString() == "Bus"sv) {
-                ts.AddBus(ParseBusQuery(ts, request));
+        std::vector<const Stop*> route;
+        for (size_t i = 0; i < base_requests_.chunks.size(); ++i) {
+            const StopReferences& refs = base_requests_.chunks[i].refs;
+            for (const auto& bus : refs.routes) {
+                route.clear();
+                for (size_t j = bus.stops_begin; j < bus.stops_end; ++j) {
+                    route.push_back(resolved_stops[i][refs.route_stops[j]]);
+                }
+                ts.AddBus(bus.bus_name, route, bus.is_roundtrip);
             }
         }
+
         return ts;
     }
 
     renderer::RenderSettings JsonReader::ParseRenderSettings() const {
         renderer::RenderSettings rs;
 
-        const auto rs_map = json_document_.GetRoot().AsDict().at("render_settings"s).AsDict();
+        const auto rs_map = GetSection("render_settings"sv).AsDict();
 
         // парсинг из json в структуру RenderSettings
         rs.width = rs_map.at("width"s).AsDouble();
@@ -261,20 +535,12 @@ namespace json_reader {
     }
 
     renderer::MapRenderer JsonReader::MapRenderFromJson(const transport::TransportCatalogue& ts) const {
-        std::vector<geo::Coordinates> stops_coords;
-        stops_coords.reserve(ts.GetStops().size());
-        for (const Bus& bus : ts.GetBuses()) {
-            for (const Stop* stop : bus.route) {
-                stops_coords.emplace_back(stop->coordinates);
-            }
-        }
-
-        return  renderer::MapRenderer(std::move(ParseRenderSettings()), stops_coords);
+        return  renderer::MapRenderer(ParseRenderSettings(), ts);
     }
 
-    svg::Color JsonReader::ParseColor(const json::Node& node) const {
+    svg::Color JsonReader::ParseColor(const json::arena::Value& node) const {
         if (node.IsString()) {
-            return node.AsString();
+            return std::string(node.AsString());
         }
 
         const auto& array = node.AsArray();
@@ -293,12 +559,110 @@ namespace json_reader {
     transport::RouterSettings JsonReader::ParseRoutSettings() const {
         transport::RouterSettings settings;
 
-        const auto rs_map = json_document_.GetRoot().AsDict().at("routing_settings"s).AsDict();
+        const auto rs_map = GetSection("routing_settings"sv).AsDict();
 
         settings.bus_wait_time_ = rs_map.at("bus_wait_time"s).AsInt();
         settings.bus_velocity_ = rs_map.at("bus_velocity"s).AsDouble();
 
+        // пешие переходы необязательны
+        if (rs_map.count("walking_radius"s) && rs_map.count("walking_velocity"s)) {
+            settings.walking_radius_ = rs_map.at("walking_radius"s).AsDouble();
+            settings.walking_velocity_ = rs_map.at("walking_velocity"s).AsDouble();
+        }
+
         return settings;
     }
 
+    serialization::SerializationSettings JsonReader::ParseSerializationSettings() const {
+        serialization::SerializationSettings settings;
+
+        const auto& ss_map = GetSection("serialization_settings"sv).AsDict();
+        settings.file = ss_map.at("file"s).AsString();
+
+        // журнал изменений по умолчанию лежит рядом с базой
+        if (ss_map.count("delta_file"s)) {
+            settings.delta_file = ss_map.at("delta_file"s).AsString();
+        }
+        else {
+            settings.delta_file = settings.file;
+            settings.delta_file += ".delta"s;
+        }
+
+        return settings;
+    }
+
+    serialization::ShardingSettings JsonReader::ParseShardingSettings() const {
+        serialization::ShardingSettings settings;
+
+        const auto& ss_map = GetSection("sharding_settings"sv).AsDict();
+        settings.file = ss_map.at("file"sv).AsString();
+        settings.shard_count = ParseCount(ss_map.at("shard_count"sv), "Shard count"sv);
+
+        return settings;
+    }
+
+    // запрос изменения: {"action": "add" | "replace" | "remove", "type": "Stop" | "Bus" | "Distance", ...};
+    // поля остановки и маршрута как в base_requests, расстояние задается полями from, to и distance
+    std::vector<serialization::Delta> JsonReader::ParseDeltaRequests() const {
+        std::vector<serialization::Delta> deltas;
+
+        const auto& requests = GetSection("delta_requests"sv).AsArray();
+        deltas.reserve(requests.size());
+        for (const auto& request : requests) {
+            const auto& request_map = request.AsDict();
+            serialization::Delta delta;
+
+            const std::string_view action = request_map.at("action"sv).AsString();
+            if (action == "add"sv) {
+                delta.action = serialization::DeltaAction::ADD;
+            }
+            else if (action == "replace"sv) {
+                delta.action = serialization::DeltaAction::REPLACE;
+            }
+            else if (action == "remove"sv) {
+                delta.action = serialization::DeltaAction::REMOVE;
+            }
+            else {
+                throw std::invalid_argument("Unknown delta action "s + std::string(action));
+            }
+            const bool removal = delta.action == serialization::DeltaAction::REMOVE;
+
+            const std::string_view type = request_map.at("type"sv).AsString();
+            if (type == "Stop"sv) {
+                serialization::StopDelta stop;
+                stop.name = request_map.at("name"sv).AsString();
+                if (!removal) {
+                    stop.coordinates = { request_map.at("latitude"sv).AsDouble(), request_map.at("longitude"sv).AsDouble() };
+                }
+                delta.object = std::move(stop);
+            }
+            else if (type == "Bus"sv) {
+                serialization::BusDelta bus;
+                bus.name = request_map.at("name"sv).AsString();
+                if (!removal) {
+                    for (const auto& stop : request_map.at("stops"sv).AsArray()) {
+                        bus.stops.emplace_back(stop.AsString());
+                    }
+                    bus.is_roundtrip = request_map.at("is_roundtrip"sv).AsBool();
+                }
+                delta.object = std::move(bus);
+            }
+            else if (type == "Distance"sv) {
+                serialization::DistanceDelta distance;
+                distance.from = request_map.at("from"sv).AsString();
+                distance.to = request_map.at("to"sv).AsString();
+                if (!removal) {
+                    distance.distance = request_map.at("distance"sv).AsInt();
+                }
+                delta.object = std::move(distance);
+            }
+            else {
+                throw std::invalid_argument("Unknown delta object type "s + std::string(type));
+            }
+            deltas.push_back(std::move(delta));
+        }
+
+        return deltas;
+    }
+
 }  // namespace json_reader
@@ -1,25 +1,48 @@
 ﻿#pragma once
+#include <deque>
+#include <future>
 #include <istream>
+#include <optional>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "request_handler.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "json.h"
+#include "json_arena.h"
+#include "json_writer.h"
+#include "serialization.h"
+#include "worker_pool.h"
 
 namespace json_reader {
 
 	class JsonReader {
 	public:
-		JsonReader(std::istream& in)
-			: in_(in)
-			, json_document_(json::Load(in_))
-		{
-		}
+		// base_requests разбираются частями в отдельных потоках во время чтения и в документе не хранятся
+		JsonReader(std::istream& in);
 
 		// Обработка запросов к каталогу через RequestHandler
 		void ResponseRequests(std::ostream& os, const transport::RequestHandler& rq) const;
 
+		// массив ответов на часть stat_requests (например, пакет для процесса-обработчика)
+		void ResponseRequests(json::arena::ArrayView requests, const transport::RequestHandler& rq, json::Writer& writer) const;
+
+		// ответ на один запрос из stat_requests пишется в writer; false - запрос неизвестного типа, ответа нет
+		bool ResponseRequest(const json::arena::Value& request, const transport::RequestHandler& rq, json::Writer& writer) const;
+
+		// Запрос из stat_requests с найденными по именам объектами; nullopt - запрос неизвестного типа
+		std::optional<transport::StatRequest> CompileStatRequest(const json::arena::Value& request, const transport::RequestHandler& rq) const;
+		// запросы неизвестного типа пропускаются
+		std::vector<transport::StatRequest> CompileStatRequests(json::arena::ArrayView requests, const transport::RequestHandler& rq) const;
+
+		void ResponseRequest(const transport::StatRequest& request, const transport::RequestHandler& rq, json::Writer& writer) const;
+
+		json::arena::ArrayView GetStatRequests() const;
+
 		// Заполнение транспортного каталога из Json
 		transport::TransportCatalogue TransportCatalogueFromJson() const;
 
@@ -28,23 +51,102 @@ namespace json_reader {
 
 		transport::RouterSettings ParseRoutSettings() const;
 
+		serialization::SerializationSettings ParseSerializationSettings() const;
+
+		serialization::ShardingSettings ParseShardingSettings() const;
+
+		// необязательные output_settings: {"compact": true} - ответы без отступов и переводов строк
+		json::Writer::Format ParseOutputFormat() const;
+
+		// необязательные worker_settings; без них запросы обрабатываются в одном процессе
+		workers::WorkerPoolSettings ParseWorkerSettings() const;
+
+		// изменения каталога из delta_requests
+		std::vector<serialization::Delta> ParseDeltaRequests() const;
+
 	private:
-		std::istream& in_;
-		json::Document json_document_;
+		// Ссылки на остановки по имени, собранные за один проход по base_requests.
+		// Остановка может быть описана позже, чем на нее сослались, поэтому имена получают номера,
+		// а в объекты каталога разрешаются одним проходом в конце чтения
+		struct StopReferences {
+			struct Distance {
+				size_t from;
+				size_t to;
+				int distance;
+			};
 
-		domain::Bus ParseBusQuery(const transport::TransportCatalogue& ts, const json::Node& type_bus) const;
-		domain::Stop ParseStopQuery(const json::Node& type_stop) const;
+			struct Route {
+				std::string bus_name;
+				size_t stops_begin;  // диапазон номеров остановок маршрута в route_stops
+				size_t stops_end;
+				bool is_roundtrip;
+			};
 
-		void ParseStopQueryDistance(transport::TransportCatalogue& ts, const json::Node& type_stop) const;
+			size_t Intern(std::string_view stop_name);
 
-		json::Dict StopResponseToJsonDict(int request_id, const std::optional<domain::StopInfo>& stop_info) const;
-		json::Dict BusResponseToJsonDict(int request_id, const std::optional<domain::BusInfo>& bus_info) const;
-		json::Dict MapResponseToJsonDict(int request_id, const svg::Document& render_doc) const;
-		json::Dict RouteResponseToJsonDict(int request_id,
-										   const std::optional<graph::Router<double>::RouteInfo>& routing,
-										   const graph::DirectedWeightedGraph<double>& graph) const;
+			std::unordered_map<std::string_view, size_t> name_ids;  // ключи указывают в names
+			std::deque<std::string> names;  // имена по номерам
+			std::vector<Distance> distances;
+			std::vector<Route> routes;
+			std::vector<size_t> route_stops;
+		};
 
-		svg::Color ParseColor(const json::Node& node) const;
+		void ParseBusQuery(StopReferences& refs, const json::arena::Value& type_bus) const;
+		domain::Stop ParseStopQuery(const json::arena::Value& type_stop) const;
+
+		void ParseStopQueryDistance(StopReferences& refs, const json::arena::Value& type_stop) const;
+
+		// Часть base_requests: запросы, скопированные из потокового разбора в свою арену,
+		// и разобранные из них остановки и ссылки на них по именам
+		struct BaseRequestsChunk {
+			json::arena::Arena arena;
+			std::vector<json::arena::Value> requests;  // освобождаются после разбора
+			std::vector<domain::Stop> stops;
+			StopReferences refs;
+		};
+
+		// base_requests, собранные при чтении документа. Полная часть разбирается в отдельном потоке,
+		// пока читается остальной документ; в каталог части добавляются в порядке входных данных
+		struct BaseRequests {
+			std::deque<BaseRequestsChunk> chunks;  // адреса частей не меняются, пока их разбирают потоки
+			std::deque<std::future<void>> pending;  // разбор отданных потокам частей, в порядке частей
+			size_t dispatched = 0;  // число частей, отданных потокам
+		};
+
+		void AddBaseRequest(const json::arena::Value& request);
+		void DispatchBaseRequestsChunk();
+		void FinishBaseRequests();
+
+		void ParseBaseRequests(BaseRequestsChunk& chunk) const;
+
+		// остановки каталога по номерам имен refs части
+		std::vector<const domain::Stop*> ResolveStopReferences(const transport::TransportCatalogue& ts,
+															   const BaseRequestsChunk& chunk) const;
+
+		void WriteNotFoundResponse(int request_id, json::Writer& writer) const;
+		void WriteStopResponse(int request_id, const domain::StopInfo& stop_info, json::Writer& writer) const;
+		void WriteBusResponse(int request_id, const domain::BusInfo& bus_info, json::Writer& writer) const;
+		void WriteDirectResponse(int request_id, const std::vector<domain::DirectBus>& direct_buses, json::Writer& writer) const;
+		void WriteNearestResponse(int request_id, const std::vector<transport::NearestStop>& nearest_stops, json::Writer& writer) const;
+		void WriteMapResponse(int request_id, const svg::Document& render_doc, json::Writer& writer) const;
+		void WriteRouteResponse(int request_id,
+								const std::optional<graph::Router<double>::RouteInfo>& routing,
+								const graph::DirectedWeightedGraph<double>& graph,
+								json::Writer& writer) const;
+
+		svg::Color ParseColor(const json::arena::Value& node) const;
+
+		// Раздел корня входного документа по ключу или nullptr. Разделы настроек при чтении документа
+		// только пропускаются и разбираются при первом обращении: запросам, которым настройки
+		// не нужны, их разбор ничего не стоит
+		const json::arena::Value* FindSection(std::string_view key) const;
+		const json::arena::Value& GetSection(std::string_view key) const;
+
+		std::istream& in_;
+		BaseRequests base_requests_;  // заполняется до json_document_, при его разборе
+		json::arena::Document json_document_;  // входной документ только читается
+		mutable std::unordered_map<std::string_view, json::arena::Document> sections_;  // разобранные отложенные разделы
+		mutable std::vector<transport::NearestStop> nearest_stops_;  // ответ на Nearest, переиспользуется между запросами
 	};
 
 
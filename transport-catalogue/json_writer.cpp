@@ -0,0 +1,243 @@
+#include "json_writer.h"
+#include "json_internal.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std::literals;
+
+namespace json {
+
+    Writer::Writer(std::ostream& output, Format format)
+        : output_(output)
+        , format_(format)
+    {
+        buffer_.reserve(FLUSH_SIZE);
+    }
+
+    Writer::~Writer() {
+        Flush();
+    }
+
+    void Writer::Flush() {
+        output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    void Writer::BeginItem() {
+        Container& container = containers_.back();
+        if (!container.empty) {
+            buffer_.append(format_ == Format::PRETTY ? ",\n"sv : ","sv);
+        }
+        container.empty = false;
+        if (format_ == Format::PRETTY) {
+            buffer_.append(containers_.size() * INDENT_STEP, ' ');
+        }
+    }
+
+    void Writer::BeginValue() {
+        if (finished_) {
+            throw std::logic_error("Attempt to change finalized JSON"s);
+        }
+        if (containers_.empty()) {
+            return;
+        }
+        if (containers_.back().is_dict) {
+            if (!key_written_) {
+                throw std::logic_error("New object in wrong context"s);
+            }
+            key_written_ = false;
+            return;
+        }
+        BeginItem();
+    }
+
+    void Writer::EndValue() {
+        if (containers_.empty()) {
+            finished_ = true;
+        }
+        if (buffer_.size() >= FLUSH_SIZE) {
+            Flush();
+        }
+    }
+
+    void Writer::EndContainer(char bracket) {
+        containers_.pop_back();
+        if (format_ == Format::PRETTY) {
+            // пустой контейнер выводится, как в json::Print: "[", пустая строка, "]"
+            buffer_.push_back('\n');
+            buffer_.append(containers_.size() * INDENT_STEP, ' ');
+        }
+        buffer_.push_back(bracket);
+        EndValue();
+    }
+
+    void Writer::WriteString(std::string_view value) {
+        // Длинная строка (например, SVG карты) экранируется кусками прямо в буфер,
+        // заполненный буфер сразу уходит в поток
+        constexpr size_t PART_SIZE = 4096;
+
+        buffer_.push_back('"');
+        for (size_t pos = 0; pos < value.size(); pos += PART_SIZE) {
+            const std::string_view part = value.substr(pos, PART_SIZE);
+            const size_t begin = buffer_.size();
+            buffer_.resize(begin + 2 * part.size());
+            buffer_.resize(detail::EscapeChars(part, buffer_.data() + begin) - buffer_.data());
+            if (buffer_.size() >= FLUSH_SIZE) {
+                Flush();
+            }
+        }
+        buffer_.push_back('"');
+    }
+
+    Writer& Writer::StartDict() {
+        BeginValue();
+        buffer_.push_back('{');
+        if (format_ == Format::PRETTY) {
+            buffer_.push_back('\n');
+        }
+        containers_.push_back({ true });
+        return *this;
+    }
+
+    Writer& Writer::EndDict() {
+        if (containers_.empty() || !containers_.back().is_dict || key_written_) {
+            throw std::logic_error("EndDict() outside a dict"s);
+        }
+        EndContainer('}');
+        return *this;
+    }
+
+    Writer& Writer::StartArray() {
+        BeginValue();
+        buffer_.push_back('[');
+        if (format_ == Format::PRETTY) {
+            buffer_.push_back('\n');
+        }
+        containers_.push_back({ false });
+        return *this;
+    }
+
+    Writer& Writer::EndArray() {
+        if (containers_.empty() || containers_.back().is_dict) {
+            throw std::logic_error("EndArray() outside an array"s);
+        }
+        EndContainer(']');
+        return *this;
+    }
+
+    Writer& Writer::Key(std::string_view key) {
+        if (containers_.empty() || !containers_.back().is_dict || key_written_) {
+            throw std::logic_error("Key() outside a dict"s);
+        }
+        BeginItem();
+        WriteString(key);
+        buffer_.append(format_ == Format::PRETTY ? ": "sv : ":"sv);
+        key_written_ = true;
+        return *this;
+    }
+
+    Writer& Writer::Value(std::nullptr_t) {
+        BeginValue();
+        buffer_.append("null"sv);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value) {
+        BeginValue();
+        buffer_.append(value ? "true"sv : "false"sv);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(int value) {
+        return Value(static_cast<int64_t>(value));
+    }
+
+    Writer& Writer::Value(int64_t value) {
+        BeginValue();
+        detail::NumberBuffer number;
+        buffer_.append(detail::FormatInt(value, number));
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(double value) {
+        BeginValue();
+        detail::NumberBuffer number;
+        buffer_.append(detail::FormatDouble(value, number));
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value) {
+        BeginValue();
+        WriteString(value);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::RawValue(std::string_view value) {
+        BeginValue();
+        const size_t indent = format_ == Format::PRETTY ? containers_.size() * INDENT_STEP : 0;
+        if (indent == 0) {
+            buffer_.append(value);
+        }
+        else {
+            // переводы строк в тексте PRETTY только между элементами, внутри строк они экранированы;
+            // пустая строка пустого контейнера остается без отступа, как у json::Print
+            for (size_t pos = 0; pos < value.size();) {
+                const size_t line_end = std::min(value.find('\n', pos), value.size());
+                buffer_.append(value.substr(pos, line_end - pos));
+                if (line_end == value.size()) {
+                    break;
+                }
+                buffer_.push_back('\n');
+                pos = line_end + 1;
+                if (pos < value.size() && value[pos] != '\n') {
+                    buffer_.append(indent, ' ');
+                }
+            }
+        }
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(const arena::Value& value) {
+        switch (value.GetType()) {
+        case arena::Value::Type::NULL_VALUE:
+            return Value(nullptr);
+        case arena::Value::Type::BOOL:
+            return Value(value.AsBool());
+        case arena::Value::Type::INT:
+            [[fallthrough]];
+        case arena::Value::Type::INT64:
+            return Value(value.AsInt64());
+        case arena::Value::Type::DOUBLE:
+            return Value(value.AsDouble());
+        case arena::Value::Type::STRING:
+            return Value(value.AsString());
+        case arena::Value::Type::ARRAY:
+            StartArray();
+            for (const arena::Value& item : value.AsArray()) {
+                Value(item);
+            }
+            return EndArray();
+        case arena::Value::Type::DICT:
+            StartDict();
+            // пары в документе уже отсортированы по ключу
+            for (const auto& [key, item] : value.AsDict()) {
+                Key(key);
+                Value(item);
+            }
+            return EndDict();
+        }
+        return *this;
+    }
+
+}  // namespace json
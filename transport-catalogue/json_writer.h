@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "json_arena.h"
+
+namespace json {
+
+    // Потоковая запись JSON без построения дерева: каждое значение сразу сериализуется в буфер,
+    // который сбрасывается в поток по мере заполнения.
+    // PRETTY выводит то же, что json::Print, если ключи словарей пишутся по алфавиту
+    // (json::Print выводит словарь отсортированным). COMPACT - без пробелов и переводов строк
+    class Writer {
+    public:
+        enum class Format {
+            PRETTY,
+            COMPACT
+        };
+
+        explicit Writer(std::ostream& output, Format format = Format::PRETTY);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        // сбрасывает записанное в поток
+        ~Writer();
+
+        Writer& StartDict();
+        Writer& EndDict();
+        Writer& StartArray();
+        Writer& EndArray();
+        Writer& Key(std::string_view key);
+
+        Writer& Value(std::nullptr_t);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(int64_t value);
+        Writer& Value(double value);
+        Writer& Value(std::string_view value);
+        Writer& Value(const char* value);
+
+        // значение разобранного документа со всем содержимым
+        Writer& Value(const arena::Value& value);
+
+        // Готовый текст значения, записанный Writer того же формата в корне, вставляется как есть,
+        // без разбора. В PRETTY его строки получают отступ текущего уровня вложенности
+        Writer& RawValue(std::string_view value);
+
+        // отдает записанное в поток, запись можно продолжать
+        void Flush();
+
+    private:
+        static constexpr size_t FLUSH_SIZE = 64 * 1024;
+        static constexpr size_t INDENT_STEP = 4;
+
+        struct Container {
+            bool is_dict;
+            bool empty = true;
+        };
+
+        std::ostream& output_;
+        Format format_;
+        std::string buffer_;
+        std::vector<Container> containers_;  // открытые массивы и словари
+        bool key_written_ = false;  // в словаре записан ключ, ожидается значение
+        bool finished_ = false;  // корневое значение записано
+
+        // проверка контекста, разделитель и отступ перед значением
+        void BeginValue();
+        // после законченного значения: сброс заполненного буфера
+        void EndValue();
+
+        // разделитель после предыдущего элемента и отступ элемента открытого контейнера
+        void BeginItem();
+        void EndContainer(char bracket);
+        void WriteString(std::string_view value);
+    };
+
+}  // namespace json
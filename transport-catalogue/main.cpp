@@ -1,16 +1,414 @@
-﻿#include <iostream>
+﻿#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "json_reader.h"
 #include "request_handler.h"
 #include "transport_catalogue.h"
-#include "json_builder.h"
+#include "json_writer.h"
+#include "serialization.h"
+#include "transport_snapshot.h"
+#include "worker_pool.h"
 
 using namespace std::literals;
 
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve_requests|update_base|compact_base|process_shards]\n"sv
+           << "       transport_catalogue make_shard <shard>\n"sv;
+}
+
+// make_base: строит каталог, граф и маршруты по base_requests и сохраняет их в файл базы
+void MakeBase(std::istream& input) {
+    json_reader::JsonReader json_reader(input);
+
+    const auto snapshot = transport::Snapshot::Build(json_reader.TransportCatalogueFromJson(),
+                                                     json_reader.ParseRenderSettings(),
+                                                     json_reader.ParseRoutSettings());
+
+    serialization::SaveTransportBase(json_reader.ParseSerializationSettings(), *snapshot);
+}
+
+// Ответы пакета от обработчика идут подряд, перед каждым - его длина (8 байт, порядок байтов хоста:
+// обработчики работают на той же машине). Так ответы вставляются в вывод как есть, без разбора
+void AppendResponseFrame(std::string& frames, std::string_view response) {
+    const uint64_t size = response.size();
+    frames.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    frames.append(response);
+}
+
+// очередной ответ из начала frames, frames сдвигается за него
+std::string_view TakeResponseFrame(std::string_view& frames) {
+    uint64_t size = 0;
+    if (frames.size() < sizeof(size)) {
+        throw std::runtime_error("Worker response is truncated"s);
+    }
+    std::memcpy(&size, frames.data(), sizeof(size));
+    frames.remove_prefix(sizeof(size));
+    if (frames.size() < size) {
+        throw std::runtime_error("Worker response is truncated"s);
+    }
+    const std::string_view response = frames.substr(0, size);
+    frames.remove_prefix(size);
+    return response;
+}
+
+// Ответы на stat_requests пакетами в процессах-обработчиках пула. Обработчики порождаются после загрузки
+// базы и используют ее память совместно; ответы собираются в порядке запросов
+void ResponseRequestsInWorkers(const json_reader::JsonReader& json_reader, const transport::RequestHandler& request_handler,
+                               const workers::WorkerPoolSettings& settings, std::ostream& output) {
+    const json::arena::ArrayView requests = json_reader.GetStatRequests();
+    const json::Writer::Format format = json_reader.ParseOutputFormat();
+
+    std::vector<std::string> batches;
+    for (size_t begin = 0; begin < requests.size(); begin += settings.batch_size) {
+        const size_t end = std::min(requests.size(), begin + settings.batch_size);
+        std::ostringstream batch;
+        {
+            json::Writer writer(batch, json::Writer::Format::COMPACT);
+            writer.StartArray();
+            for (size_t i = begin; i < end; ++i) {
+                writer.Value(requests[i]);
+            }
+            writer.EndArray();
+        }
+        batches.push_back(batch.str());
+    }
+
+    // маршрутизатор снимка строится лениво; если он нужен запросам, его надо построить до порождения
+    // обработчиков, иначе каждый обработчик построит свой
+    const bool has_routes = std::any_of(requests.begin(), requests.end(), [](const json::arena::Value& request) {
+        return request.AsDict().at("type"sv).AsString() == "Route"sv;
+    });
+    if (has_routes) {
+        request_handler.GetRouterGraph();
+    }
+
+    // обработчики пишут каждый ответ сразу в выходном формате, как корневое значение
+    workers::WorkerPool pool(settings.worker_count, [&json_reader, &request_handler, format](std::string_view batch) {
+        const json::arena::Document requests = json::arena::Load(batch);
+        std::string frames;
+        std::ostringstream response;
+        for (const transport::StatRequest& request : json_reader.CompileStatRequests(requests.GetRoot().AsArray(), request_handler)) {
+            response.str({});
+            {
+                json::Writer writer(response, format);
+                json_reader.ResponseRequest(request, request_handler, writer);
+            }
+            AppendResponseFrame(frames, response.str());
+        }
+        return frames;
+    });
+
+    json::Writer writer(output, format);
+    writer.StartArray();
+    for (const std::string& batch_responses : pool.Process(batches)) {
+        for (std::string_view frames = batch_responses; !frames.empty();) {
+            writer.RawValue(TakeResponseFrame(frames));
+        }
+    }
+    writer.EndArray();
+}
+
+// process_requests: отвечает на stat_requests по готовому файлу базы; если к базе есть журнал
+// изменений, каталог собирается заново, а маршруты пересчитываются только в затронутых компонентах
+void ProcessRequests(std::istream& input, std::ostream& output) {
+    json_reader::JsonReader json_reader(input);
+
+    transport::RequestHandler request_handler(serialization::LoadSnapshot(json_reader.ParseSerializationSettings()));
+
+    const workers::WorkerPoolSettings worker_settings = json_reader.ParseWorkerSettings();
+    if (worker_settings.worker_count > 1) {
+        ResponseRequestsInWorkers(json_reader, request_handler, worker_settings, output);
+        return;
+    }
+
+    json_reader.ResponseRequests(output, request_handler);
+}
+
+// Подхватывает изменения, которые update_base дописывает в журнал, пока работает serve_requests.
+// Поток раз в POLL_INTERVAL сравнивает размер журнала с прежним и, если он изменился, строит следующую
+// версию снимка вместе с маршрутизатором и публикует ее. Запросы тем временем отвечаются по текущей версии.
+// После compact_base журнал привязан к новой базе, его изменения подхватит только перезапуск
+class DeltaWatcher {
+public:
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{ 100 };
+
+    DeltaWatcher(serialization::SerializationSettings settings, uint64_t base_checksum, transport::SnapshotPublisher& publisher)
+        : settings_(std::move(settings))
+        , base_checksum_(base_checksum)
+        , publisher_(publisher)
+        , thread_([this] { Run(); })
+    {
+    }
+
+    DeltaWatcher(const DeltaWatcher&) = delete;
+    DeltaWatcher& operator=(const DeltaWatcher&) = delete;
+
+    ~DeltaWatcher() {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        stop_.notify_one();
+        thread_.join();
+    }
+
+private:
+    // размер журнала; при его отсутствии - значение, которое не совпадет с размером файла
+    std::uintmax_t LogSize() const {
+        std::error_code error;
+        return std::filesystem::file_size(settings_.delta_file, error);
+    }
+
+    void Run() {
+        std::unique_lock lock(mutex_);
+        while (!stop_.wait_for(lock, POLL_INTERVAL, [this] { return stopped_; })) {
+            const std::uintmax_t log_size = LogSize();
+            if (log_size == log_size_) {
+                continue;
+            }
+            // размер запоминается и при ошибке: поврежденный журнал не читается заново до следующей записи
+            log_size_ = log_size;
+            try {
+                const auto snapshot = serialization::UpdateSnapshot(settings_, base_checksum_, publisher_.Get());
+                snapshot->GetRouter();
+                publisher_.Publish(snapshot);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to apply base updates: "sv << e.what() << '\n';
+            }
+        }
+    }
+
+    const serialization::SerializationSettings settings_;
+    const uint64_t base_checksum_;
+    transport::SnapshotPublisher& publisher_;
+    // размер журнала при последней проверке; до первой проверки неизвестен: изменения, записанные
+    // между загрузкой снимка и запуском потока, подхватываются первой же проверкой
+    std::optional<std::uintmax_t> log_size_;
+
+    std::mutex mutex_;
+    std::condition_variable stop_;
+    bool stopped_ = false;
+    std::thread thread_;  // последним: поток использует остальные поля
+};
+
+// serve_requests: первая строка ввода - документ с serialization_settings, как у process_requests, но без
+// stat_requests. База загружается один раз, затем каждая следующая строка - один запрос в формате stat_requests,
+// ответ на него выводится одной строкой сразу, не дожидаясь следующих запросов. На каждую непустую строку
+// выводится ровно одна строка ответа: на ошибочный запрос или запрос неизвестного типа - {"error_message": ...},
+// с request_id, если строка разобрана и в ней есть id. Изменения, дописанные update_base во время работы,
+// применяются к запросам, прочитанным после публикации новой версии (см. DeltaWatcher)
+void ServeRequests(std::istream& input, std::ostream& output) {
+    std::string line;
+    if (!std::getline(input, line)) {
+        throw std::invalid_argument("Settings are expected on the first line"s);
+    }
+    std::istringstream settings(line);
+    json_reader::JsonReader json_reader(settings);
+    const serialization::SerializationSettings serialization_settings = json_reader.ParseSerializationSettings();
+
+    uint64_t base_checksum = 0;
+    transport::SnapshotPublisher publisher(serialization::LoadSnapshot(serialization_settings, &base_checksum));
+    std::shared_ptr<const transport::Snapshot> snapshot = publisher.Get();
+    std::optional<transport::RequestHandler> request_handler(std::in_place, snapshot);
+    // маршрутизатор строится лениво, первый запрос Route не должен ждать его построения
+    request_handler->GetRouterGraph();
 
-int main() {
+    DeltaWatcher delta_watcher(serialization_settings, base_checksum, publisher);
+
+    std::ostringstream response;
+    while (std::getline(input, line)) {
+        if (line.find_first_not_of(" \t\r"sv) == std::string::npos) {
+            continue;
+        }
+
+        // новая версия берется между запросами: каждый запрос отвечается целиком по одному снимку
+        if (auto published = publisher.Get(); published != snapshot) {
+            snapshot = std::move(published);
+            request_handler.emplace(snapshot);
+        }
+
+        // ответ собирается целиком, чтобы при ошибке посреди запроса строка ответа не оказалась испорчена
+        response.str({});
+        std::optional<int> request_id;
+        std::optional<std::string> error_message;
+        try {
+            const json::arena::Document request = json::arena::Load(line);
+            // id читается до разбора остального запроса, чтобы попасть и в ответ об ошибке
+            if (request.GetRoot().IsDict()) {
+                if (const json::arena::Value* id = request.GetRoot().AsDict().Find("id"sv); id != nullptr && id->IsInt()) {
+                    request_id = id->AsInt();
+                }
+            }
+            json::Writer writer(response, json::Writer::Format::COMPACT);
+            if (!json_reader.ResponseRequest(request.GetRoot(), *request_handler, writer)) {
+                error_message = "unknown request type"s;
+            }
+        }
+        catch (const std::exception& e) {
+            error_message = e.what();
+        }
+
+        if (error_message) {
+            response.str({});
+            json::Writer writer(response, json::Writer::Format::COMPACT);
+            writer.StartDict().Key("error_message"sv).Value(*error_message);
+            if (request_id) {
+                writer.Key("request_id"sv).Value(*request_id);
+            }
+            writer.EndDict();
+        }
+        output << response.str() << '\n' << std::flush;
+    }
+}
+
+// update_base: проверяет изменения из delta_requests и дописывает их в журнал базы
+void UpdateBase(std::istream& input) {
+    json_reader::JsonReader json_reader(input);
+
+    serialization::AppendDeltas(json_reader.ParseSerializationSettings(), json_reader.ParseDeltaRequests());
+}
+
+// compact_base: применяет журнал изменений к базе, сохраняет новую базу и удаляет журнал
+void CompactBase(std::istream& input) {
+    json_reader::JsonReader json_reader(input);
+
+    const serialization::SerializationSettings settings = json_reader.ParseSerializationSettings();
+    const auto snapshot = serialization::LoadSnapshot(settings);
+    if (snapshot->GetVersion() == 0) {
+        return;
+    }
+
+    // старая база остается отображенной в память до конца работы, новая встает на ее место атомарно
+    serialization::SaveTransportBase(settings, *snapshot);
+    std::filesystem::remove(settings.delta_file);
+}
+
+// make_shard <shard>: строит таблицу маршрутов одного шарда и сохраняет ее в файл шарда.
+// Шарды строятся независимыми процессами, каждый читает тот же JSON; шард 0 строит и оверлей
+void MakeShard(std::istream& input, size_t shard) {
+    json_reader::JsonReader json_reader(input);
+
+    const transport::TransportCatalogue catalogue = json_reader.TransportCatalogueFromJson();
+    const transport::RouterSettings router_settings = json_reader.ParseRoutSettings();
+    const serialization::ShardingSettings settings = json_reader.ParseShardingSettings();
+    if (shard >= settings.shard_count) {
+        throw std::invalid_argument("Shard "s + std::to_string(shard) + " is out of range"s);
+    }
+
+    const std::vector<size_t> stop_shards = transport::PartitionStops(catalogue, settings.shard_count);
+    const uint64_t routing_checksum = serialization::ComputeRoutingChecksum(catalogue, router_settings);
+    const auto routes = transport::Router::BuildShardRoutes(router_settings, catalogue, stop_shards, shard);
+    serialization::SaveShardRoutes(settings, shard, routing_checksum, { routes.data(), routes.data() + routes.size() });
+
+    if (shard == 0) {
+        serialization::SaveShardOverlay(settings, routing_checksum,
+                                        transport::Router::BuildShardOverlay(router_settings, catalogue, stop_shards));
+    }
+}
+
+// process_shards: отвечает на stat_requests по таблицам шардов, построенным make_shard
+void ProcessShards(std::istream& input, std::ostream& output) {
+    json_reader::JsonReader json_reader(input);
+
+    transport::TransportCatalogue catalogue = json_reader.TransportCatalogueFromJson();
+    const transport::RouterSettings router_settings = json_reader.ParseRoutSettings();
+    const serialization::ShardingSettings settings = json_reader.ParseShardingSettings();
+
+    const uint64_t routing_checksum = serialization::ComputeRoutingChecksum(catalogue, router_settings);
+    const std::vector<size_t> stop_shards = transport::PartitionStops(catalogue, settings.shard_count);
+
+    // отображенные в память таблицы живут вместе со снимком
+    struct ShardImages {
+        std::vector<serialization::ShardRoutes> shards;
+        serialization::ShardOverlay overlay;
+    };
+    auto shard_images = std::make_shared<ShardImages>();
+    std::vector<graph::Router<double>::RoutesInternalData> shard_routes;
+    for (size_t shard = 0; shard < settings.shard_count; ++shard) {
+        shard_images->shards.push_back(serialization::LoadShardRoutes(settings, shard, routing_checksum));
+        shard_routes.push_back(shard_images->shards.back().routes);
+    }
+    shard_images->overlay = serialization::LoadShardOverlay(settings, routing_checksum);
+
+    transport::RequestHandler request_handler(std::make_shared<const transport::Snapshot>(
+        std::move(catalogue),
+        [&json_reader](const transport::TransportCatalogue& catalogue) {
+            return json_reader.MapRenderFromJson(catalogue);
+        },
+        [router_settings, stop_shards = std::move(stop_shards), shard_routes = std::move(shard_routes),
+         overlay = &shard_images->overlay](const transport::TransportCatalogue& catalogue) {
+            return std::make_unique<const transport::Router>(router_settings, catalogue, stop_shards, shard_routes,
+                                                             overlay->edges, overlay->routes);
+        },
+        0, std::move(shard_images)));
+
+    json_reader.ResponseRequests(output, request_handler);
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc == 3 && argv[1] == "make_shard"sv) {
+        try {
+            MakeShard(std::cin, std::stoul(argv[2]));
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc == 2) {
+        const std::string_view mode(argv[1]);
+
+        try {
+            if (mode == "make_base"sv) {
+                MakeBase(std::cin);
+            }
+            else if (mode == "process_requests"sv) {
+                ProcessRequests(std::cin, std::cout);
+            }
+            else if (mode == "serve_requests"sv) {
+                ServeRequests(std::cin, std::cout);
+            }
+            else if (mode == "update_base"sv) {
+                UpdateBase(std::cin);
+            }
+            else if (mode == "compact_base"sv) {
+                CompactBase(std::cin);
+            }
+            else if (mode == "process_shards"sv) {
+                ProcessShards(std::cin, std::cout);
+            }
+            else {
+                PrintUsage();
+                return 1;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc != 1) {
+        PrintUsage();
+        return 1;
+    }
     
     /*
     //Для чтения из файла
@@ -33,13 +431,15 @@ int main() {
 
     transport::TransportCatalogue transport_catalogue = json_reader.TransportCatalogueFromJson();
 
-    renderer::MapRenderer map_render = json_reader.MapRenderFromJson(transport_catalogue);
-
-    transport::RouterSettings router_settings = json_reader.ParseRoutSettings();
-
-    transport::Router router = { router_settings, transport_catalogue };
-
-    transport::RequestHandler request_handler(transport_catalogue, map_render, router);
+    // настройки отрисовки и маршрутизации разбираются, только если их потребуют запросы Map и Route
+    transport::RequestHandler request_handler(std::make_shared<const transport::Snapshot>(
+        std::move(transport_catalogue),
+        [&json_reader](const transport::TransportCatalogue& catalogue) {
+            return json_reader.MapRenderFromJson(catalogue);
+        },
+        [&json_reader](const transport::TransportCatalogue& catalogue) {
+            return std::make_unique<const transport::Router>(json_reader.ParseRoutSettings(), catalogue);
+        }));
 
     json_reader.ResponseRequests(std::cout, request_handler);
     
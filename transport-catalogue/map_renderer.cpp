@@ -14,7 +14,21 @@ namespace renderer {
     {
     }
 
-	void MapRenderer::BusRouteRender(svg::Document& render_doc, const domain::Bus& bus, size_t color) const {
+    static std::vector<geo::Coordinates> StopsWithBusesCoordinates(const transport::TransportCatalogue& catalogue) {
+        std::vector<geo::Coordinates> stops_coords;
+        stops_coords.reserve(catalogue.GetStops().size());
+        for (const domain::Stop* stop : catalogue.BusesForStop()) {
+            stops_coords.emplace_back(stop->coordinates);
+        }
+        return stops_coords;
+    }
+
+    MapRenderer::MapRenderer(RenderSettings&& render_settings, const transport::TransportCatalogue& catalogue)
+        : MapRenderer(std::move(render_settings), StopsWithBusesCoordinates(catalogue))
+    {
+    }
+
+	void MapRenderer::BusRouteRender(svg::Document& render_doc, domain::RouteView route, size_t color) const {
 		// создаём Polyline из данных render_settings_
 		svg::Polyline poly = svg::Polyline()
 			.SetFillColor(svg::NoneColor)
@@ -23,18 +37,9 @@ namespace renderer {
 			.SetStrokeLineCap(svg::StrokeLineCap::ROUND)
 			.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-		// "проецируем" точки в poly, с помощью sphere_proj_ для кольцевого маршрута
-		if (bus.is_roundtrip) {
-			for (const auto& elem : bus.route) {
-				poly.AddPoint(sphere_proj_(elem->coordinates));
-			}
-		}
-
-		// "проецируем" для некольцевого
-		if (!bus.is_roundtrip) {
-			for (const auto& elem : bus.route) {
-				poly.AddPoint(sphere_proj_(elem->coordinates));
-			}
+		// "проецируем" точки в poly, с помощью sphere_proj_ (некольцевой маршрут обходится туда и обратно)
+		for (const domain::Stop* elem : route) {
+			poly.AddPoint(sphere_proj_(elem->coordinates));
 		}
 
 		render_doc.Add(std::move(poly));
@@ -62,21 +67,17 @@ namespace renderer {
 		return bus_text;
 	}
 	
-	void MapRenderer::BusTextRender(svg::Document& render_doc, const domain::Bus& bus, size_t color) const {
-		render_doc.Add(std::move(BusTextRenderSettings(bus.name, bus.route.front(), true)));
-		render_doc.Add(std::move(BusTextRenderSettings(bus.name, bus.route.front(), false, color)));
-
-		auto bus_route_end = bus.route.size() / 2;
-		auto back_stop_it = bus.route.begin() + bus_route_end;
-		if (!bus.is_roundtrip && bus.route.size() > 3 && *bus.route.begin() != *back_stop_it) {  // для некольцевых длиной больше 3х остановок (н-р: A-B-C-B-A)
-			render_doc.Add(std::move(BusTextRenderSettings(bus.name, *back_stop_it, true)));
-			render_doc.Add(std::move(BusTextRenderSettings(bus.name, *back_stop_it, false, color)));
-		}
-		if (!bus.is_roundtrip && bus.route.size() == 3 && bus.route.front() != *back_stop_it) {  // для некольцевых длиной 3 остановки, вместе с возвратом (н-р: A-B-A)
-			render_doc.Add(std::move(BusTextRenderSettings(bus.name, *back_stop_it, true)));
-			render_doc.Add(std::move(BusTextRenderSettings(bus.name, *back_stop_it, false, color)));
+	void MapRenderer::BusTextRender(svg::Document& render_doc, const domain::Bus& bus, domain::RouteView route, size_t color) const {
+		const domain::Stop* first_stop = route.front();
+		render_doc.Add(std::move(BusTextRenderSettings(bus.name, first_stop, true)));
+		render_doc.Add(std::move(BusTextRenderSettings(bus.name, first_stop, false, color)));
+
+		// для некольцевых подписываем и вторую конечную, если она отличается от первой (н-р: A-B-C-B-A)
+		const domain::Stop* back_stop = route.terminal();
+		if (!bus.is_roundtrip && first_stop != back_stop) {
+			render_doc.Add(std::move(BusTextRenderSettings(bus.name, back_stop, true)));
+			render_doc.Add(std::move(BusTextRenderSettings(bus.name, back_stop, false, color)));
 		}
-	
 	}
 
 	svg::Text MapRenderer::StopTextRenderSettings(const domain::Stop* stop, bool is_underlayer) const {
@@ -107,33 +108,27 @@ namespace renderer {
 	}
 
 	// основной метод рендера
-	svg::Document MapRenderer::RenderRoutes(const std::deque<domain::Bus>& buses_storage, const std::deque<const domain::Stop*> buses_for_stop) const {
+	svg::Document MapRenderer::RenderRoutes(const transport::TransportCatalogue& catalogue) const {
 		svg::Document render_doc;
 
-		
-		std::deque<domain::Bus> buses;
-		for (const domain::Bus& bus : buses_storage) {
-			if (!bus.route.empty()) {
-				buses.push_back(bus);
-			}
-
-		}
-
-		std::sort(buses.begin(), buses.end(), [](const domain::Bus& lhs, const domain::Bus& rhs) {
-			return lhs.name < rhs.name;
-			}); 
-
+		// маршруты без остановок не рисуются и не занимают цвет палитры
 		size_t bus_counter = 0;
-		for (const auto& bus : buses) {
-			BusRouteRender(render_doc, bus, bus_counter % render_settings_.color_palette.size());
-			++bus_counter;
+		for (const domain::Bus* bus : catalogue.GetSortedBuses()) {
+			if (bus->stops_count > 0) {
+				BusRouteRender(render_doc, catalogue.GetRoute(*bus), bus_counter % render_settings_.color_palette.size());
+				++bus_counter;
+			}
 		}
 		
 		bus_counter = 0;
-		for (const auto& bus : buses) {
-			BusTextRender(render_doc, bus, bus_counter % render_settings_.color_palette.size());
-			++bus_counter;
+		for (const domain::Bus* bus : catalogue.GetSortedBuses()) {
+			if (bus->stops_count > 0) {
+				BusTextRender(render_doc, *bus, catalogue.GetRoute(*bus), bus_counter % render_settings_.color_palette.size());
+				++bus_counter;
+			}
 		}
+
+		const domain::StopRange buses_for_stop = catalogue.BusesForStop();
 		
 		for (const domain::Stop* stop : buses_for_stop) {
 			StopRender(render_doc, stop);
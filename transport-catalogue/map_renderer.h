@@ -3,6 +3,7 @@
 #include "geo.h"
 #include "svg.h"
 #include "domain.h"
+#include "transport_catalogue.h"
 
 #include <algorithm>
 #include <cstdlib>
@@ -135,10 +136,17 @@ namespace renderer {
     public:
         MapRenderer(RenderSettings&& render_settings, const std::vector<geo::Coordinates>& stops_coords);
 
-        void BusRouteRender(svg::Document& render_doc, const domain::Bus& bus, size_t color) const;
+        // карта масштабируется по остановкам каталога, через которые проходят маршруты
+        MapRenderer(RenderSettings&& render_settings, const transport::TransportCatalogue& catalogue);
+
+        const RenderSettings& GetRenderSettings() const {
+            return render_settings_;
+        }
+
+        void BusRouteRender(svg::Document& render_doc, domain::RouteView route, size_t color) const;
         svg::Text BusTextRenderSettings(const std::string& bus_name, const domain::Stop* stop, bool is_underlayer, size_t color = 0) const;
 
-        void BusTextRender(svg::Document& render_doc, const domain::Bus& bus, size_t color) const;
+        void BusTextRender(svg::Document& render_doc, const domain::Bus& bus, domain::RouteView route, size_t color) const;
         svg::Text StopTextRenderSettings(const domain::Stop* stop, bool is_underlayer) const;
 
         inline void StopTextRender(svg::Document& render_doc, const domain::Stop* stop) const {
@@ -148,7 +156,7 @@ namespace renderer {
 
         void StopRender(svg::Document& render_doc, const domain::Stop* stop) const;
 
-        svg::Document RenderRoutes(const std::deque<domain::Bus>& buses_storage, const std::deque<const domain::Stop*> buses_for_stop) const;
+        svg::Document RenderRoutes(const transport::TransportCatalogue& catalogue) const;
 
     private:
         RenderSettings render_settings_;
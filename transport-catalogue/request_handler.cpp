@@ -11,16 +11,52 @@ namespace transport {
 		return db_.GetBusesForStop(stop_name);
 	}
 
+	std::optional<std::vector<domain::DirectBus>> RequestHandler::GetDirectBuses(const std::string_view stop_from, const std::string_view stop_to) const {
+		return db_.GetDirectBuses(stop_from, stop_to);
+	}
+
+	void RequestHandler::GetNearestStops(geo::Coordinates center, size_t count, std::vector<NearestStop>& result) const {
+		db_.FindNearestStops(center, count, result);
+	}
+
 	svg::Document RequestHandler::RenderMap() const {
-		return renderer_.RenderRoutes(db_.GetBuses(), db_.BusesForStop());
+		return snapshot_->GetRenderer().RenderRoutes(db_);
 	}
 
 	const std::optional<graph::Router<double>::RouteInfo> RequestHandler::GetOptimalRoute(const std::string_view stop_from, const std::string_view stop_to) const {
-		return router_.FindRoute(stop_from, stop_to);
+		return snapshot_->GetRouter().FindRoute(stop_from, stop_to);
 	}
 
 	const graph::DirectedWeightedGraph<double>& RequestHandler::GetRouterGraph() const {
-		return router_.GetGraph();
+		return snapshot_->GetRouter().GetGraph();
+	}
+
+	const domain::Stop* RequestHandler::FindStop(std::string_view stop_name) const {
+		return db_.FindStop(stop_name);
+	}
+
+	const domain::Bus* RequestHandler::FindBus(std::string_view bus_name) const {
+		return db_.FindBus(bus_name);
+	}
+
+	std::optional<graph::VertexId> RequestHandler::FindRouteVertex(std::string_view stop_name) const {
+		return snapshot_->GetRouter().FindStopVertex(stop_name);
+	}
+
+	domain::BusInfo RequestHandler::GetBusInfo(const domain::Bus& bus) const {
+		return db_.GetBusInfo(bus);
+	}
+
+	domain::StopInfo RequestHandler::GetBusesByStop(const domain::Stop& stop) const {
+		return db_.GetBusesForStop(stop);
+	}
+
+	std::vector<domain::DirectBus> RequestHandler::GetDirectBuses(const domain::Stop& from, const domain::Stop& to) const {
+		return db_.GetDirectBuses(from, to);
+	}
+
+	const std::optional<graph::Router<double>::RouteInfo> RequestHandler::GetOptimalRoute(graph::VertexId from, graph::VertexId to) const {
+		return snapshot_->GetRouter().FindRoute(from, to);
 	}
 
 }  // namespace transport
\ No newline at end of file
@@ -1,19 +1,54 @@
 ﻿#pragma once
 #include "transport_catalogue.h"
 #include "transport_router.h"
+#include "transport_snapshot.h"
 #include "map_renderer.h"
 
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <set>
+#include <string_view>
+#include <vector>
 
 namespace transport {
 
+	// Запрос из stat_requests, разобранный заранее: имена остановок и автобусов уже найдены в каталоге,
+	// а остановки запроса Route - в графе маршрутизатора. Выполнение такого запроса ничего не ищет по имени
+	struct StatRequest {
+		enum class Type : uint8_t {
+			STOP,
+			BUS,
+			DIRECT,
+			NEAREST,
+			MAP,
+			ROUTE
+		};
+
+		Type type = Type::STOP;
+		bool found = true;  // все объекты запроса есть в каталоге, иначе ответ - "not found"
+		int id = 0;
+
+		const domain::Stop* from = nullptr;  // Stop, Direct
+		const domain::Stop* to = nullptr;  // Direct
+		const domain::Bus* bus = nullptr;  // Bus
+		graph::VertexId from_vertex = 0;  // Route
+		graph::VertexId to_vertex = 0;
+		geo::Coordinates center;  // Nearest
+		size_t count = 0;
+
+		// Nearest возвращает не больше стольких остановок: иначе один запрос с огромным count
+		// превращается в обход всего индекса и ответ на весь каталог
+		static constexpr size_t MAX_NEAREST_COUNT = 100;
+	};
+
 	class RequestHandler {
 	public:
-		RequestHandler(const TransportCatalogue& catalogue, const renderer::MapRenderer& renderer, const transport::Router& router)
-			: db_(catalogue)
-			, renderer_(renderer)
-			, router_(router)
+		// обработчик держит снимок, пока жив сам: опубликованная позже версия на него не влияет
+		// Отрисовщик и маршрутизатор снимка берутся при запросе: до первого запроса Map или Route они не строятся
+		explicit RequestHandler(std::shared_ptr<const Snapshot> snapshot)
+			: snapshot_(std::move(snapshot))
+			, db_(snapshot_->GetCatalogue())
 		{
 		}
 
@@ -22,7 +57,13 @@ namespace transport {
 
 		// Возвращает маршруты, проходящие через
 		std::optional<domain::StopInfo> GetBusesByStop(const std::string_view& stop_name) const;
+
+		// Возвращает автобусы, которые довозят между остановками без пересадки (запрос Direct)
+		std::optional<std::vector<domain::DirectBus>> GetDirectBuses(const std::string_view stop_from, const std::string_view stop_to) const;
 		
+		// count ближайших к точке остановок (запрос Nearest) в result; буфер result переиспользуется между запросами
+		void GetNearestStops(geo::Coordinates center, size_t count, std::vector<NearestStop>& result) const;
+
 		// построение SVG
 		svg::Document RenderMap() const;
 
@@ -30,10 +71,20 @@ namespace transport {
 
 		const graph::DirectedWeightedGraph<double>& GetRouterGraph() const;
 
+		// Поиск по имени для заранее разобранных запросов (StatRequest); nullptr или nullopt, если не найдено
+		const domain::Stop* FindStop(std::string_view stop_name) const;
+		const domain::Bus* FindBus(std::string_view bus_name) const;
+		std::optional<graph::VertexId> FindRouteVertex(std::string_view stop_name) const;
+
+		// те же запросы по найденным объектам
+		domain::BusInfo GetBusInfo(const domain::Bus& bus) const;
+		domain::StopInfo GetBusesByStop(const domain::Stop& stop) const;
+		std::vector<domain::DirectBus> GetDirectBuses(const domain::Stop& from, const domain::Stop& to) const;
+		const std::optional<graph::Router<double>::RouteInfo> GetOptimalRoute(graph::VertexId from, graph::VertexId to) const;
+
 	private:
-		const TransportCatalogue db_;
-		const renderer::MapRenderer& renderer_;
-		const transport::Router& router_;
+		std::shared_ptr<const Snapshot> snapshot_;
+		const TransportCatalogue& db_;
 	};
 
 }  // namespace transport
\ No newline at end of file
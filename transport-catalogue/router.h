@@ -1,11 +1,13 @@
 #pragma once
 
 #include "graph.h"
+#include "ranges.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -20,8 +22,29 @@ namespace graph {
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
+        // Маршрут между парой вершин. Таблица маршрутов плоская (vertex_count x vertex_count, по строкам)
+        // и не содержит указателей, поэтому ее можно использовать прямо из отображенного в память файла
+        struct RouteInternalData {
+            Weight weight;
+            EdgeId prev_edge;  // последнее ребро маршрута, NO_EDGE или NO_ROUTE
+        };
+        using RoutesInternalData = ranges::Range<const RouteInternalData*>;
+
+        static constexpr EdgeId NO_ROUTE = std::numeric_limits<EdgeId>::max();  // маршрута нет
+        static constexpr EdgeId NO_EDGE = NO_ROUTE - 1;  // маршрут без ребер (из вершины в саму себя)
+
         explicit Router(const Graph& graph);
 
+        // маршруты, рассчитанные ранее для того же графа (например, в файле базы);
+        // таблица не копируется и должна жить дольше маршрутизатора
+        Router(const Graph& graph, RoutesInternalData routes_internal_data);
+
+        // Таблица, часть которой уже известна: маршруты внутри каждой группы вершин из recompute
+        // рассчитываются заново, остальные записи берутся из routes_internal_data как есть.
+        // Группа должна быть замкнута: ребра из ее вершин ведут только в ее же вершины
+        Router(const Graph& graph, std::vector<RouteInternalData> routes_internal_data,
+               const std::vector<std::vector<VertexId>>& recompute);
+
         struct RouteInfo {
             Weight weight;
             std::vector<EdgeId> edges;
@@ -29,24 +52,44 @@ namespace graph {
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        // вес кратчайшего маршрута без восстановления его ребер
+        std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const {
+            const auto& route_internal_data = At(from, to);
+            if (route_internal_data.prev_edge == NO_ROUTE) {
+                return std::nullopt;
+            }
+            return route_internal_data.weight;
+        }
+
+        RoutesInternalData GetRoutesInternalData() const {
+            return { routes_, routes_ + vertex_count_ * vertex_count_ };
+        }
+
+        // забирает рассчитанную таблицу без копирования; маршрутизатор после этого не используется
+        std::vector<RouteInternalData> ReleaseRoutesInternalData() && {
+            routes_ = nullptr;
+            return std::move(own_routes_);
+        }
+
     private:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
-        };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        RouteInternalData& At(VertexId from, VertexId to) {
+            return own_routes_[from * vertex_count_ + to];
+        }
 
-        void InitializeRoutesInternalData(const Graph& graph) {
-            const size_t vertex_count = graph.GetVertexCount();
-            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+        const RouteInternalData& At(VertexId from, VertexId to) const {
+            return routes_[from * vertex_count_ + to];
+        }
+
+        void InitializeRoutesInternalData(const Graph& graph, const std::vector<VertexId>& vertices) {
+            for (const VertexId vertex : vertices) {
+                At(vertex, vertex) = RouteInternalData{ ZERO_WEIGHT, NO_EDGE };
                 for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                     const auto& edge = graph.GetEdge(edge_id);
                     if (edge.weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
+                    auto& route_internal_data = At(vertex, edge.to);
+                    if (route_internal_data.prev_edge == NO_ROUTE || route_internal_data.weight > edge.weight) {
                         route_internal_data = RouteInternalData{ edge.weight, edge_id };
                     }
                 }
@@ -55,63 +98,116 @@ namespace graph {
 
         void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
             const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
+            auto& route_relaxing = At(vertex_from, vertex_to);
             const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
+            if (route_relaxing.prev_edge == NO_ROUTE || candidate_weight < route_relaxing.weight) {
                 route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+                                  route_to.prev_edge != NO_EDGE ? route_to.prev_edge : route_from.prev_edge };
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
+        void RelaxRoutesInternalDataThroughVertex(const std::vector<VertexId>& vertices, VertexId vertex_through) {
+            for (const VertexId vertex_from : vertices) {
+                const RouteInternalData route_from = At(vertex_from, vertex_through);
+                if (route_from.prev_edge == NO_ROUTE) {
+                    continue;
+                }
+                for (const VertexId vertex_to : vertices) {
+                    const RouteInternalData& route_to = At(vertex_through, vertex_to);
+                    if (route_to.prev_edge != NO_ROUTE) {
+                        RelaxRoute(vertex_from, vertex_to, route_from, route_to);
                     }
                 }
             }
         }
 
+        // Флойд-Уоршелл по замкнутой группе вершин, перечисленных по возрастанию
+        void ComputeRoutesInternalData(const Graph& graph, const std::vector<VertexId>& vertices) {
+            for (const VertexId vertex_from : vertices) {
+                for (const VertexId vertex_to : vertices) {
+                    At(vertex_from, vertex_to) = RouteInternalData{ ZERO_WEIGHT, NO_ROUTE };
+                }
+            }
+            InitializeRoutesInternalData(graph, vertices);
+
+            for (const VertexId vertex_through : vertices) {
+                RelaxRoutesInternalDataThroughVertex(vertices, vertex_through);
+            }
+        }
+
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
-        RoutesInternalData routes_internal_data_;
+        size_t vertex_count_ = 0;
+        std::vector<RouteInternalData> own_routes_;  // пусто, если таблица внешняя
+        const RouteInternalData* routes_ = nullptr;
     };
 
     template <typename Weight>
     Router<Weight>::Router(const Graph& graph)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , vertex_count_(graph.GetVertexCount())
+        , own_routes_(vertex_count_ * vertex_count_, RouteInternalData{ ZERO_WEIGHT, NO_ROUTE })
+    {
+        std::vector<VertexId> vertices(vertex_count_);
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            vertices[vertex] = vertex;
+        }
+        ComputeRoutesInternalData(graph, vertices);
+        routes_ = own_routes_.data();
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, RoutesInternalData routes_internal_data)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , routes_(routes_internal_data.begin())
     {
-        InitializeRoutesInternalData(graph);
+        if (static_cast<size_t>(routes_internal_data.end() - routes_internal_data.begin()) != vertex_count_ * vertex_count_) {
+            throw std::invalid_argument("Routes data doesn't match the graph");
+        }
+    }
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, std::vector<RouteInternalData> routes_internal_data,
+                           const std::vector<std::vector<VertexId>>& recompute)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , own_routes_(std::move(routes_internal_data))
+    {
+        if (own_routes_.size() != vertex_count_ * vertex_count_) {
+            throw std::invalid_argument("Routes data doesn't match the graph");
+        }
+        for (const auto& vertices : recompute) {
+            ComputeRoutesInternalData(graph, vertices);
         }
+        routes_ = own_routes_.data();
     }
 
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            throw std::out_of_range("Vertex is out of range");
+        }
+        const auto& route_internal_data = At(from, to);
+        if (route_internal_data.prev_edge == NO_ROUTE) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
+        const Weight weight = route_internal_data.weight;
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        for (EdgeId edge_id = route_internal_data.prev_edge;
+            edge_id != NO_EDGE;
+            edge_id = At(from, graph_.GetEdge(edge_id).from).prev_edge)
         {
-            edges.push_back(*edge_id);
+            // внешняя таблица могла быть повреждена: простой маршрут не длиннее числа вершин
+            if (edge_id == NO_ROUTE || edges.size() == vertex_count_) {
+                throw std::runtime_error("Routes data is inconsistent");
+            }
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
         return RouteInfo{ weight, std::move(edges) };
     }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
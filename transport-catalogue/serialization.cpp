@@ -0,0 +1,1199 @@
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TRANSPORT_BASE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace serialization {
+
+    namespace {
+
+        // Формат файла: заголовок, метаданные (каталог, настройки, граф) и таблица маршрутов.
+        // Заголовок: сигнатура, версия формата, размер метаданных и их контрольная сумма (FNV-1a),
+        // смещение и число записей таблицы маршрутов.
+        // Числа пишутся в little-endian, double - по битам,
+        // поэтому загруженные значения совпадают с сохраненными до последнего бита
+        const char MAGIC[8] = { 'T', 'C', 'A', 'T', 'B', 'A', 'S', 'E' };
+        const uint32_t FORMAT_VERSION = 2;
+        const size_t HEADER_SIZE = sizeof(MAGIC) + 4 + 4 + 8 + 8 + 8 + 8;
+
+        uint64_t ComputeChecksum(std::string_view data) {
+            uint64_t hash = 14695981039346656037ull;
+            for (const char c : data) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        class Writer {
+        public:
+            void WriteUInt(uint64_t value, size_t bytes = 8) {
+                for (size_t i = 0; i < bytes; ++i) {
+                    data_.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+                }
+            }
+
+            void WriteInt(int64_t value) {
+                WriteUInt(static_cast<uint64_t>(value));
+            }
+
+            void WriteDouble(double value) {
+                uint64_t bits = 0;
+                std::memcpy(&bits, &value, sizeof(bits));
+                WriteUInt(bits);
+            }
+
+            void WriteString(std::string_view value) {
+                WriteUInt(value.size());
+                data_.append(value);
+            }
+
+            std::string& Data() {
+                return data_;
+            }
+
+        private:
+            std::string data_;
+        };
+
+        class Reader {
+        public:
+            explicit Reader(std::string_view data)
+                : data_(data) {
+            }
+
+            uint64_t ReadUInt(size_t bytes = 8) {
+                Require(bytes);
+                uint64_t value = 0;
+                for (size_t i = 0; i < bytes; ++i) {
+                    value |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i])) << (i * 8);
+                }
+                pos_ += bytes;
+                return value;
+            }
+
+            int64_t ReadInt() {
+                return static_cast<int64_t>(ReadUInt());
+            }
+
+            double ReadDouble() {
+                const uint64_t bits = ReadUInt();
+                double value = 0;
+                std::memcpy(&value, &bits, sizeof(value));
+                return value;
+            }
+
+            std::string_view ReadString() {
+                const size_t size = ReadUInt();
+                Require(size);
+                const std::string_view value = data_.substr(pos_, size);
+                pos_ += size;
+                return value;
+            }
+
+            // количество элементов, каждый из которых занимает не меньше min_item_size байт:
+            // не дает поврежденному счетчику выделить лишнюю память
+            size_t ReadCount(size_t min_item_size) {
+                const uint64_t count = ReadUInt();
+                if (count > (data_.size() - pos_) / min_item_size) {
+                    throw SnapshotError("Transport base is truncated"s);
+                }
+                return static_cast<size_t>(count);
+            }
+
+            // номер элемента, меньший count
+            size_t ReadIndex(size_t count) {
+                const uint64_t index = ReadUInt();
+                if (index >= count) {
+                    throw SnapshotError("Transport base refers to a missing element"s);
+                }
+                return static_cast<size_t>(index);
+            }
+
+            bool AtEnd() const {
+                return pos_ == data_.size();
+            }
+
+        private:
+            std::string_view data_;
+            size_t pos_ = 0;
+
+            void Require(size_t bytes) const {
+                if (bytes > data_.size() - pos_) {
+                    throw SnapshotError("Transport base is truncated"s);
+                }
+            }
+        };
+
+        // ---------------- каталог ----------------
+
+        void WriteCatalogue(Writer& out, const transport::TransportCatalogue& catalogue) {
+            const auto& stops = catalogue.GetStops();
+            out.WriteUInt(stops.size());
+            for (const Stop& stop : stops) {
+                out.WriteString(stop.name);
+                out.WriteDouble(stop.coordinates.lat);
+                out.WriteDouble(stop.coordinates.lng);
+            }
+
+            // порядок расстояний в хеш-таблице не определен, пишем их по id остановок,
+            // чтобы одинаковый каталог давал одинаковый файл
+            std::vector<std::pair<std::pair<size_t, size_t>, size_t>> distances;
+            distances.reserve(catalogue.GetAllStopPairDistances().size());
+            for (const auto& [stops_pair, distance] : catalogue.GetAllStopPairDistances()) {
+                distances.push_back({ { stops_pair.first->id, stops_pair.second->id }, distance });
+            }
+            std::sort(distances.begin(), distances.end());
+
+            out.WriteUInt(distances.size());
+            for (const auto& [stops_pair, distance] : distances) {
+                out.WriteUInt(stops_pair.first);
+                out.WriteUInt(stops_pair.second);
+                out.WriteUInt(distance);
+            }
+
+            const auto& buses = catalogue.GetBuses();
+            out.WriteUInt(buses.size());
+            for (const Bus& bus : buses) {
+                out.WriteString(bus.name);
+                out.WriteUInt(bus.is_roundtrip ? 1 : 0, 1);
+
+                const RouteView route = catalogue.GetRoute(bus).Declared();
+                out.WriteUInt(route.size());
+                for (const Stop* stop : route) {
+                    out.WriteUInt(stop->id);
+                }
+            }
+        }
+
+        void ReadCatalogue(Reader& in, transport::TransportCatalogue& catalogue) {
+            const size_t stops_count = in.ReadCount(8 + 8 + 8);
+            for (size_t i = 0; i < stops_count; ++i) {
+                Stop stop;
+                stop.name = in.ReadString();
+                stop.coordinates.lat = in.ReadDouble();
+                stop.coordinates.lng = in.ReadDouble();
+                catalogue.AddStop(std::move(stop));
+            }
+            const auto& stops = catalogue.GetStops();
+
+            const size_t distances_count = in.ReadCount(8 + 8 + 8);
+            for (size_t i = 0; i < distances_count; ++i) {
+                const Stop* from = &stops[in.ReadIndex(stops_count)];
+                const Stop* to = &stops[in.ReadIndex(stops_count)];
+                catalogue.AddStopPairDistances(from, to, in.ReadUInt());
+            }
+
+            const size_t buses_count = in.ReadCount(8 + 1 + 8);
+            std::vector<const Stop*> route;
+            for (size_t i = 0; i < buses_count; ++i) {
+                std::string name(in.ReadString());
+                const bool is_roundtrip = in.ReadUInt(1) != 0;
+
+                route.resize(in.ReadCount(8));
+                for (const Stop*& stop : route) {
+                    stop = &stops[in.ReadIndex(stops_count)];
+                }
+                catalogue.AddBus(std::move(name), route, is_roundtrip);
+            }
+        }
+
+        // ---------------- настройки отрисовки ----------------
+
+        enum class ColorType : uint8_t {
+            NONE,
+            STRING,
+            RGB,
+            RGBA
+        };
+
+        void WriteColor(Writer& out, const svg::Color& color) {
+            if (const auto* name = std::get_if<std::string>(&color)) {
+                out.WriteUInt(static_cast<uint8_t>(ColorType::STRING), 1);
+                out.WriteString(*name);
+            }
+            else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+                out.WriteUInt(static_cast<uint8_t>(ColorType::RGB), 1);
+                out.WriteUInt(rgb->red, 1);
+                out.WriteUInt(rgb->green, 1);
+                out.WriteUInt(rgb->blue, 1);
+            }
+            else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+                out.WriteUInt(static_cast<uint8_t>(ColorType::RGBA), 1);
+                out.WriteUInt(rgba->red, 1);
+                out.WriteUInt(rgba->green, 1);
+                out.WriteUInt(rgba->blue, 1);
+                out.WriteDouble(rgba->opacity);
+            }
+            else {
+                out.WriteUInt(static_cast<uint8_t>(ColorType::NONE), 1);
+            }
+        }
+
+        svg::Color ReadColor(Reader& in) {
+            switch (static_cast<ColorType>(in.ReadUInt(1))) {
+            case ColorType::NONE:
+                return {};
+            case ColorType::STRING:
+                return std::string(in.ReadString());
+            case ColorType::RGB: {
+                const uint8_t red = in.ReadUInt(1);
+                const uint8_t green = in.ReadUInt(1);
+                const uint8_t blue = in.ReadUInt(1);
+                return svg::Rgb(red, green, blue);
+            }
+            case ColorType::RGBA: {
+                const uint8_t red = in.ReadUInt(1);
+                const uint8_t green = in.ReadUInt(1);
+                const uint8_t blue = in.ReadUInt(1);
+                return svg::Rgba(red, green, blue, in.ReadDouble());
+            }
+            }
+            throw SnapshotError("Transport base has an unknown color type"s);
+        }
+
+        void WritePoint(Writer& out, svg::Point point) {
+            out.WriteDouble(point.x);
+            out.WriteDouble(point.y);
+        }
+
+        svg::Point ReadPoint(Reader& in) {
+            const double x = in.ReadDouble();
+            return { x, in.ReadDouble() };
+        }
+
+        void WriteRenderSettings(Writer& out, const renderer::RenderSettings& rs) {
+            out.WriteDouble(rs.width);
+            out.WriteDouble(rs.height);
+            out.WriteDouble(rs.padding);
+            out.WriteDouble(rs.line_width);
+            out.WriteDouble(rs.stop_radius);
+            out.WriteInt(rs.bus_label_font_size);
+            WritePoint(out, rs.bus_label_offset);
+            out.WriteInt(rs.stop_label_font_size);
+            WritePoint(out, rs.stop_label_offset);
+            WriteColor(out, rs.underlayer_color);
+            out.WriteDouble(rs.underlayer_width);
+
+            out.WriteUInt(rs.color_palette.size());
+            for (const svg::Color& color : rs.color_palette) {
+                WriteColor(out, color);
+            }
+        }
+
+        renderer::RenderSettings ReadRenderSettings(Reader& in) {
+            renderer::RenderSettings rs;
+            rs.width = in.ReadDouble();
+            rs.height = in.ReadDouble();
+            rs.padding = in.ReadDouble();
+            rs.line_width = in.ReadDouble();
+            rs.stop_radius = in.ReadDouble();
+            rs.bus_label_font_size = static_cast<int>(in.ReadInt());
+            rs.bus_label_offset = ReadPoint(in);
+            rs.stop_label_font_size = static_cast<int>(in.ReadInt());
+            rs.stop_label_offset = ReadPoint(in);
+            rs.underlayer_color = ReadColor(in);
+            rs.underlayer_width = in.ReadDouble();
+
+            rs.color_palette.resize(in.ReadCount(1));
+            for (svg::Color& color : rs.color_palette) {
+                color = ReadColor(in);
+            }
+            return rs;
+        }
+
+        // ---------------- маршрутизация ----------------
+
+        void WriteRouterSettings(Writer& out, const transport::RouterSettings& settings) {
+            out.WriteInt(settings.bus_wait_time_);
+            out.WriteDouble(settings.bus_velocity_);
+            out.WriteDouble(settings.walking_radius_);
+            out.WriteDouble(settings.walking_velocity_);
+        }
+
+        transport::RouterSettings ReadRouterSettings(Reader& in) {
+            transport::RouterSettings settings;
+            settings.bus_wait_time_ = static_cast<int>(in.ReadInt());
+            settings.bus_velocity_ = in.ReadDouble();
+            settings.walking_radius_ = in.ReadDouble();
+            settings.walking_velocity_ = in.ReadDouble();
+            return settings;
+        }
+
+        void WriteGraph(Writer& out, const graph::DirectedWeightedGraph<double>& graph) {
+            out.WriteUInt(graph.GetVertexCount());
+            out.WriteUInt(graph.GetEdgeCount());
+            for (graph::EdgeId id = 0; id < graph.GetEdgeCount(); ++id) {
+                const graph::Edge<double>& edge = graph.GetEdge(id);
+                out.WriteString(edge.name);
+                out.WriteUInt(edge.quality);
+                out.WriteUInt(edge.from);
+                out.WriteUInt(edge.to);
+                out.WriteDouble(edge.weight);
+                out.WriteUInt(static_cast<uint8_t>(edge.type), 1);
+            }
+        }
+
+        graph::DirectedWeightedGraph<double> ReadGraph(Reader& in) {
+            // у каждой вершины есть хотя бы одно ребро (ожидание или приезд на остановку),
+            // поэтому их не больше, чем байт в оставшихся данных
+            const size_t vertex_count = in.ReadCount(1);
+            graph::DirectedWeightedGraph<double> graph(vertex_count);
+
+            const size_t edge_count = in.ReadCount(8 + 8 + 8 + 8 + 8 + 1);
+            for (size_t i = 0; i < edge_count; ++i) {
+                graph::Edge<double> edge;
+                edge.name = in.ReadString();
+                edge.quality = in.ReadUInt();
+                edge.from = in.ReadIndex(vertex_count);
+                edge.to = in.ReadIndex(vertex_count);
+                edge.weight = in.ReadDouble();
+
+                const uint8_t type = in.ReadUInt(1);
+                if (type > static_cast<uint8_t>(graph::EdgeType::WALK)) {
+                    throw SnapshotError("Transport base has an unknown edge type"s);
+                }
+                edge.type = static_cast<graph::EdgeType>(type);
+                graph.AddEdge(edge);
+            }
+            return graph;
+        }
+
+        // ---------------- таблица маршрутов ----------------
+
+        // Таблица маршрутов занимает vertex_count^2 записей и используется из файла на месте,
+        // поэтому пишется в памяти как есть: little-endian, без указателей, с выравниванием
+        using RouteInternalData = graph::Router<double>::RouteInternalData;
+        static_assert(std::is_trivially_copyable_v<RouteInternalData> && sizeof(RouteInternalData) == 16,
+                      "Route table layout must match the file format");
+        const size_t ROUTES_ALIGNMENT = alignof(RouteInternalData);
+
+        bool IsLittleEndian() {
+            const uint16_t value = 1;
+            uint8_t first_byte = 0;
+            std::memcpy(&first_byte, &value, 1);
+            return first_byte == 1;
+        }
+
+        size_t AlignRoutesOffset(size_t offset) {
+            return (offset + ROUTES_ALIGNMENT - 1) / ROUTES_ALIGNMENT * ROUTES_ALIGNMENT;
+        }
+
+    }  // namespace
+
+    // Файл базы, отображенный в память только для чтения. Страницы подгружаются при обращении
+    // и разделяются между всеми процессами, открывшими тот же файл.
+    // Без mmap (не POSIX) файл читается в выровненный буфер целиком
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path& file) {
+#ifdef TRANSPORT_BASE_MMAP
+            const int fd = ::open(file.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw SnapshotError("Failed to open transport base "s + file.string());
+            }
+            struct stat file_stat {};
+            if (::fstat(fd, &file_stat) != 0) {
+                ::close(fd);
+                throw SnapshotError("Failed to open transport base "s + file.string());
+            }
+            size_ = static_cast<size_t>(file_stat.st_size);
+            if (size_ > 0) {
+                void* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                if (data == MAP_FAILED) {
+                    ::close(fd);
+                    throw SnapshotError("Failed to map transport base "s + file.string());
+                }
+                data_ = static_cast<const char*>(data);
+            }
+            ::close(fd);
+#else
+            std::ifstream input(file, std::ios::binary | std::ios::ate);
+            if (!input) {
+                throw SnapshotError("Failed to open transport base "s + file.string());
+            }
+            size_ = static_cast<size_t>(input.tellg());
+            buffer_.resize((size_ + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            input.seekg(0);
+            input.read(reinterpret_cast<char*>(buffer_.data()), size_);
+            if (!input) {
+                throw SnapshotError("Failed to read transport base "s + file.string());
+            }
+            data_ = reinterpret_cast<const char*>(buffer_.data());
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+#ifdef TRANSPORT_BASE_MMAP
+            if (data_ != nullptr) {
+                ::munmap(const_cast<char*>(data_), size_);
+            }
+#endif
+        }
+
+        std::string_view Data() const {
+            return { data_, size_ };
+        }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+#ifndef TRANSPORT_BASE_MMAP
+        std::vector<uint64_t> buffer_;
+#endif
+    };
+
+    void SaveTransportBase(const SerializationSettings& settings, const transport::Snapshot& snapshot) {
+        const transport::TransportCatalogue& catalogue = snapshot.GetCatalogue();
+        const renderer::MapRenderer& renderer = snapshot.GetRenderer();
+        const transport::Router& router = snapshot.GetRouter();
+
+        if (!IsLittleEndian()) {
+            throw std::runtime_error("Transport base requires a little-endian platform"s);
+        }
+
+        Writer metadata;
+        WriteCatalogue(metadata, catalogue);
+        WriteRenderSettings(metadata, renderer.GetRenderSettings());
+        WriteRouterSettings(metadata, router.GetSettings());
+        WriteGraph(metadata, router.GetGraph());
+
+        const auto routes = router.GetRoutesInternalData();
+        const size_t routes_count = routes.end() - routes.begin();
+        const size_t routes_offset = AlignRoutesOffset(HEADER_SIZE + metadata.Data().size());
+
+        Writer header;
+        header.Data().append(MAGIC, sizeof(MAGIC));
+        header.WriteUInt(FORMAT_VERSION, 4);
+        header.WriteUInt(0, 4);  // зарезервировано
+        header.WriteUInt(metadata.Data().size());
+        header.WriteUInt(ComputeChecksum(metadata.Data()));
+        header.WriteUInt(routes_offset);
+        header.WriteUInt(routes_count);
+        metadata.Data().resize(routes_offset - HEADER_SIZE, '\0');
+
+        std::filesystem::path temp_file = settings.file;
+        temp_file += ".tmp"s;
+        {
+            std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+            out.write(header.Data().data(), header.Data().size());
+            out.write(metadata.Data().data(), metadata.Data().size());
+            out.write(reinterpret_cast<const char*>(routes.begin()), routes_count * sizeof(RouteInternalData));
+            out.close();
+            if (!out) {
+                throw std::runtime_error("Failed to write transport base "s + temp_file.string());
+            }
+        }
+        std::filesystem::rename(temp_file, settings.file);
+    }
+
+    TransportBase LoadTransportBase(const SerializationSettings& settings) {
+        if (!IsLittleEndian()) {
+            throw SnapshotError("Transport base requires a little-endian platform"s);
+        }
+
+        auto image = std::make_shared<const MappedFile>(settings.file);
+        const std::string_view data = image->Data();
+
+        if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            throw SnapshotError("Not a transport base file"s);
+        }
+        Reader header(data.substr(sizeof(MAGIC), HEADER_SIZE - sizeof(MAGIC)));
+        const uint32_t version = static_cast<uint32_t>(header.ReadUInt(4));
+        if (version != FORMAT_VERSION) {
+            throw SnapshotError("Unsupported transport base version "s + std::to_string(version));
+        }
+        header.ReadUInt(4);  // зарезервировано
+        const uint64_t metadata_size = header.ReadUInt();
+        const uint64_t checksum = header.ReadUInt();
+        const uint64_t routes_offset = header.ReadUInt();
+        const uint64_t routes_count = header.ReadUInt();
+
+        // контрольная сумма покрывает все, кроме таблицы маршрутов: проверка таблицы затронула бы
+        // каждую ее страницу. Ребра маршрутов проверяет graph::Router при обходе
+        if (metadata_size > data.size() - HEADER_SIZE
+            || routes_offset != AlignRoutesOffset(HEADER_SIZE + metadata_size)
+            || routes_offset > data.size()
+            || routes_count != (data.size() - routes_offset) / sizeof(RouteInternalData)
+            || (data.size() - routes_offset) % sizeof(RouteInternalData) != 0) {
+            throw SnapshotError("Transport base is truncated"s);
+        }
+        const std::string_view metadata = data.substr(HEADER_SIZE, metadata_size);
+        if (ComputeChecksum(metadata) != checksum) {
+            throw SnapshotError("Transport base is corrupted"s);
+        }
+
+        Reader in(metadata);
+        TransportBase base;
+        ReadCatalogue(in, base.catalogue);
+        base.render_settings = ReadRenderSettings(in);
+        base.router_settings = ReadRouterSettings(in);
+        base.graph = ReadGraph(in);
+        if (!in.AtEnd()) {
+            throw SnapshotError("Transport base has unexpected trailing data"s);
+        }
+
+        const size_t vertex_count = base.graph.GetVertexCount();
+        if (routes_count != vertex_count * vertex_count) {
+            throw SnapshotError("Transport base routes don't match the graph"s);
+        }
+        const auto* routes = reinterpret_cast<const RouteInternalData*>(data.data() + routes_offset);
+        base.routes_internal_data = { routes, routes + routes_count };
+        base.image = std::move(image);
+        base.checksum = checksum;
+        return base;
+    }
+
+    namespace {
+
+        // Файл шарда: заголовок (сигнатура, версия, контрольная сумма исходных данных, номер шарда,
+        // число шардов, число записей таблицы) и таблица маршрутов шарда в том же виде, что и в базе
+        const char SHARD_MAGIC[8] = { 'T', 'C', 'A', 'T', 'S', 'H', 'R', 'D' };
+        const uint32_t SHARD_FORMAT_VERSION = 2;
+        const size_t SHARD_HEADER_SIZE = sizeof(SHARD_MAGIC) + 4 + 4 + 8 + 8 + 8 + 8;
+
+        std::filesystem::path ShardFile(const ShardingSettings& settings, size_t shard) {
+            std::filesystem::path file = settings.file;
+            file += "."s + std::to_string(shard);
+            return file;
+        }
+
+        // Файл оверлея: заголовок (сигнатура, версия, контрольная сумма исходных данных, число шардов,
+        // число ребер, число записей таблицы), ребра оверлея по 7 полей в 8 байт и таблица маршрутов
+        const char OVERLAY_MAGIC[8] = { 'T', 'C', 'A', 'T', 'O', 'V', 'R', 'L' };
+        const uint32_t OVERLAY_FORMAT_VERSION = 1;
+        const size_t OVERLAY_HEADER_SIZE = sizeof(OVERLAY_MAGIC) + 4 + 4 + 8 + 8 + 8 + 8;
+        const size_t OVERLAY_EDGE_SIZE = 7 * 8;
+
+        using OverlayEdge = graph::ShardedRouter<double>::OverlayEdge;
+
+        std::filesystem::path OverlayFile(const ShardingSettings& settings) {
+            std::filesystem::path file = settings.file;
+            file += ".overlay"s;
+            return file;
+        }
+
+    }  // namespace
+
+    uint64_t ComputeRoutingChecksum(const transport::TransportCatalogue& catalogue, const transport::RouterSettings& settings) {
+        Writer data;
+        WriteCatalogue(data, catalogue);
+        WriteRouterSettings(data, settings);
+        return ComputeChecksum(data.Data());
+    }
+
+    void SaveShardRoutes(const ShardingSettings& settings, size_t shard, uint64_t routing_checksum,
+                         graph::Router<double>::RoutesInternalData routes) {
+        if (!IsLittleEndian()) {
+            throw std::runtime_error("Shard routes require a little-endian platform"s);
+        }
+        const size_t routes_count = routes.end() - routes.begin();
+
+        Writer header;
+        header.Data().append(SHARD_MAGIC, sizeof(SHARD_MAGIC));
+        header.WriteUInt(SHARD_FORMAT_VERSION, 4);
+        header.WriteUInt(0, 4);  // зарезервировано
+        header.WriteUInt(routing_checksum);
+        header.WriteUInt(shard);
+        header.WriteUInt(settings.shard_count);
+        header.WriteUInt(routes_count);
+
+        const std::filesystem::path file = ShardFile(settings, shard);
+        std::filesystem::path temp_file = file;
+        temp_file += ".tmp"s;
+        {
+            std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+            out.write(header.Data().data(), header.Data().size());
+            out.write(reinterpret_cast<const char*>(routes.begin()), routes_count * sizeof(RouteInternalData));
+            out.close();
+            if (!out) {
+                throw std::runtime_error("Failed to write shard routes "s + temp_file.string());
+            }
+        }
+        std::filesystem::rename(temp_file, file);
+    }
+
+    ShardRoutes LoadShardRoutes(const ShardingSettings& settings, size_t shard, uint64_t routing_checksum) {
+        if (!IsLittleEndian()) {
+            throw SnapshotError("Shard routes require a little-endian platform"s);
+        }
+
+        const std::filesystem::path file = ShardFile(settings, shard);
+        auto image = std::make_shared<const MappedFile>(file);
+        const std::string_view data = image->Data();
+        if (data.size() < SHARD_HEADER_SIZE || std::memcmp(data.data(), SHARD_MAGIC, sizeof(SHARD_MAGIC)) != 0) {
+            throw SnapshotError("Not a shard routes file "s + file.string());
+        }
+
+        Reader header(data.substr(sizeof(SHARD_MAGIC), SHARD_HEADER_SIZE - sizeof(SHARD_MAGIC)));
+        const uint32_t version = static_cast<uint32_t>(header.ReadUInt(4));
+        if (version != SHARD_FORMAT_VERSION) {
+            throw SnapshotError("Unsupported shard routes version "s + std::to_string(version));
+        }
+        header.ReadUInt(4);  // зарезервировано
+        if (header.ReadUInt() != routing_checksum) {
+            throw SnapshotError("Shard routes "s + file.string() + " were built from other data"s);
+        }
+        if (header.ReadUInt() != shard || header.ReadUInt() != settings.shard_count) {
+            throw SnapshotError("Shard routes "s + file.string() + " belong to another sharding"s);
+        }
+        const uint64_t routes_count = header.ReadUInt();
+        if ((data.size() - SHARD_HEADER_SIZE) / sizeof(RouteInternalData) != routes_count
+            || (data.size() - SHARD_HEADER_SIZE) % sizeof(RouteInternalData) != 0) {
+            throw SnapshotError("Shard routes "s + file.string() + " are truncated"s);
+        }
+
+        ShardRoutes result;
+        const auto* routes = reinterpret_cast<const RouteInternalData*>(data.data() + SHARD_HEADER_SIZE);
+        result.routes = { routes, routes + routes_count };
+        result.image = std::move(image);
+        return result;
+    }
+
+    void SaveShardOverlay(const ShardingSettings& settings, uint64_t routing_checksum,
+                          const graph::ShardedRouter<double>::Overlay& overlay) {
+        if (!IsLittleEndian()) {
+            throw std::runtime_error("Shard overlay requires a little-endian platform"s);
+        }
+
+        Writer header;
+        header.Data().append(OVERLAY_MAGIC, sizeof(OVERLAY_MAGIC));
+        header.WriteUInt(OVERLAY_FORMAT_VERSION, 4);
+        header.WriteUInt(0, 4);  // зарезервировано
+        header.WriteUInt(routing_checksum);
+        header.WriteUInt(settings.shard_count);
+        header.WriteUInt(overlay.edges.size());
+        header.WriteUInt(overlay.routes.size());
+        for (const OverlayEdge& edge : overlay.edges) {
+            header.WriteUInt(edge.from);
+            header.WriteUInt(edge.to);
+            header.WriteDouble(edge.weight);
+            header.WriteUInt(static_cast<uint64_t>(edge.kind));
+            header.WriteUInt(edge.id);
+            header.WriteUInt(edge.first);
+            header.WriteUInt(edge.second);
+        }
+
+        const std::filesystem::path file = OverlayFile(settings);
+        std::filesystem::path temp_file = file;
+        temp_file += ".tmp"s;
+        {
+            std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+            out.write(header.Data().data(), header.Data().size());
+            out.write(reinterpret_cast<const char*>(overlay.routes.data()), overlay.routes.size() * sizeof(RouteInternalData));
+            out.close();
+            if (!out) {
+                throw std::runtime_error("Failed to write shard overlay "s + temp_file.string());
+            }
+        }
+        std::filesystem::rename(temp_file, file);
+    }
+
+    ShardOverlay LoadShardOverlay(const ShardingSettings& settings, uint64_t routing_checksum) {
+        if (!IsLittleEndian()) {
+            throw SnapshotError("Shard overlay requires a little-endian platform"s);
+        }
+
+        const std::filesystem::path file = OverlayFile(settings);
+        auto image = std::make_shared<const MappedFile>(file);
+        const std::string_view data = image->Data();
+        if (data.size() < OVERLAY_HEADER_SIZE || std::memcmp(data.data(), OVERLAY_MAGIC, sizeof(OVERLAY_MAGIC)) != 0) {
+            throw SnapshotError("Not a shard overlay file "s + file.string());
+        }
+
+        Reader header(data.substr(sizeof(OVERLAY_MAGIC), OVERLAY_HEADER_SIZE - sizeof(OVERLAY_MAGIC)));
+        const uint32_t version = static_cast<uint32_t>(header.ReadUInt(4));
+        if (version != OVERLAY_FORMAT_VERSION) {
+            throw SnapshotError("Unsupported shard overlay version "s + std::to_string(version));
+        }
+        header.ReadUInt(4);  // зарезервировано
+        if (header.ReadUInt() != routing_checksum) {
+            throw SnapshotError("Shard overlay "s + file.string() + " was built from other data"s);
+        }
+        if (header.ReadUInt() != settings.shard_count) {
+            throw SnapshotError("Shard overlay "s + file.string() + " belongs to another sharding"s);
+        }
+        const uint64_t edges_count = header.ReadUInt();
+        const uint64_t routes_count = header.ReadUInt();
+        const size_t available = data.size() - OVERLAY_HEADER_SIZE;
+        if (edges_count > available / OVERLAY_EDGE_SIZE
+            || (available - edges_count * OVERLAY_EDGE_SIZE) / sizeof(RouteInternalData) != routes_count
+            || (available - edges_count * OVERLAY_EDGE_SIZE) % sizeof(RouteInternalData) != 0) {
+            throw SnapshotError("Shard overlay "s + file.string() + " is truncated"s);
+        }
+
+        ShardOverlay result;
+        Reader edges(data.substr(OVERLAY_HEADER_SIZE, edges_count * OVERLAY_EDGE_SIZE));
+        result.edges.reserve(edges_count);
+        for (uint64_t i = 0; i < edges_count; ++i) {
+            OverlayEdge& edge = result.edges.emplace_back();
+            edge.from = edges.ReadUInt();
+            edge.to = edges.ReadUInt();
+            edge.weight = edges.ReadDouble();
+            const uint64_t kind = edges.ReadUInt();
+            if (kind > static_cast<uint64_t>(OverlayEdge::Kind::SHORTCUT)) {
+                throw SnapshotError("Shard overlay "s + file.string() + " has an unknown edge kind"s);
+            }
+            edge.kind = static_cast<OverlayEdge::Kind>(kind);
+            edge.id = edges.ReadUInt();
+            edge.first = edges.ReadUInt();
+            edge.second = edges.ReadUInt();
+        }
+
+        const auto* routes = reinterpret_cast<const RouteInternalData*>(data.data() + OVERLAY_HEADER_SIZE + edges_count * OVERLAY_EDGE_SIZE);
+        result.routes = { routes, routes + routes_count };
+        result.image = std::move(image);
+        return result;
+    }
+
+    namespace {
+
+        // Журнал: заголовок (сигнатура, версия, контрольная сумма базы) и записи.
+        // Запись: размер данных, их контрольная сумма и сами данные - одно изменение
+        const char DELTA_MAGIC[8] = { 'T', 'C', 'A', 'T', 'D', 'L', 'O', 'G' };
+        const uint32_t DELTA_FORMAT_VERSION = 1;
+        const size_t DELTA_HEADER_SIZE = sizeof(DELTA_MAGIC) + 4 + 4 + 8;
+        const size_t DELTA_RECORD_HEADER_SIZE = 4 + 8;
+
+        enum class DeltaObject : uint8_t {
+            STOP,
+            BUS,
+            DISTANCE
+        };
+
+        void WriteDelta(Writer& out, const Delta& delta) {
+            out.WriteUInt(static_cast<uint8_t>(delta.action), 1);
+            if (const auto* stop = std::get_if<StopDelta>(&delta.object)) {
+                out.WriteUInt(static_cast<uint8_t>(DeltaObject::STOP), 1);
+                out.WriteString(stop->name);
+                out.WriteDouble(stop->coordinates.lat);
+                out.WriteDouble(stop->coordinates.lng);
+            }
+            else if (const auto* bus = std::get_if<BusDelta>(&delta.object)) {
+                out.WriteUInt(static_cast<uint8_t>(DeltaObject::BUS), 1);
+                out.WriteString(bus->name);
+                out.WriteUInt(bus->is_roundtrip ? 1 : 0, 1);
+                out.WriteUInt(bus->stops.size());
+                for (const std::string& stop : bus->stops) {
+                    out.WriteString(stop);
+                }
+            }
+            else {
+                const auto& distance = std::get<DistanceDelta>(delta.object);
+                out.WriteUInt(static_cast<uint8_t>(DeltaObject::DISTANCE), 1);
+                out.WriteString(distance.from);
+                out.WriteString(distance.to);
+                out.WriteUInt(distance.distance);
+            }
+        }
+
+        Delta ReadDelta(Reader& in) {
+            Delta delta;
+            const uint8_t action = in.ReadUInt(1);
+            if (action > static_cast<uint8_t>(DeltaAction::REMOVE)) {
+                throw SnapshotError("Delta log has an unknown action"s);
+            }
+            delta.action = static_cast<DeltaAction>(action);
+
+            switch (static_cast<DeltaObject>(in.ReadUInt(1))) {
+            case DeltaObject::STOP: {
+                StopDelta stop;
+                stop.name = in.ReadString();
+                stop.coordinates.lat = in.ReadDouble();
+                stop.coordinates.lng = in.ReadDouble();
+                delta.object = std::move(stop);
+                break;
+            }
+            case DeltaObject::BUS: {
+                BusDelta bus;
+                bus.name = in.ReadString();
+                bus.is_roundtrip = in.ReadUInt(1) != 0;
+                bus.stops.resize(in.ReadCount(8));
+                for (std::string& stop : bus.stops) {
+                    stop = in.ReadString();
+                }
+                delta.object = std::move(bus);
+                break;
+            }
+            case DeltaObject::DISTANCE: {
+                DistanceDelta distance;
+                distance.from = in.ReadString();
+                distance.to = in.ReadString();
+                distance.distance = in.ReadUInt();
+                delta.object = std::move(distance);
+                break;
+            }
+            default:
+                throw SnapshotError("Delta log has an unknown object type"s);
+            }
+            if (!in.AtEnd()) {
+                throw SnapshotError("Delta log record has unexpected trailing data"s);
+            }
+            return delta;
+        }
+
+        // Записи журнала и длина его целой части: после нее может остаться недописанная запись
+        struct DeltaLog {
+            std::vector<Delta> deltas;
+            size_t valid_size = 0;
+        };
+
+        DeltaLog ReadDeltaLog(const std::filesystem::path& file, uint64_t base_checksum) {
+            DeltaLog log;
+            std::ifstream input(file, std::ios::binary);
+            if (!input) {
+                return log;
+            }
+            const std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            if (data.size() < DELTA_HEADER_SIZE) {
+                // заголовок не успели дописать: журнал пуст
+                return log;
+            }
+
+            if (std::memcmp(data.data(), DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0) {
+                throw SnapshotError("Not a delta log file"s);
+            }
+            Reader header(std::string_view(data).substr(sizeof(DELTA_MAGIC), DELTA_HEADER_SIZE - sizeof(DELTA_MAGIC)));
+            const uint32_t version = static_cast<uint32_t>(header.ReadUInt(4));
+            if (version != DELTA_FORMAT_VERSION) {
+                throw SnapshotError("Unsupported delta log version "s + std::to_string(version));
+            }
+            header.ReadUInt(4);  // зарезервировано
+            if (header.ReadUInt() != base_checksum) {
+                throw SnapshotError("Delta log belongs to another transport base (was the base compacted?)"s);
+            }
+
+            size_t pos = DELTA_HEADER_SIZE;
+            while (data.size() - pos >= DELTA_RECORD_HEADER_SIZE) {
+                Reader record_header(std::string_view(data).substr(pos, DELTA_RECORD_HEADER_SIZE));
+                const size_t size = record_header.ReadUInt(4);
+                const uint64_t checksum = record_header.ReadUInt();
+                if (data.size() - pos - DELTA_RECORD_HEADER_SIZE < size) {
+                    break;
+                }
+
+                const std::string_view record = std::string_view(data).substr(pos + DELTA_RECORD_HEADER_SIZE, size);
+                if (ComputeChecksum(record) != checksum) {
+                    throw SnapshotError("Delta log is corrupted"s);
+                }
+                Reader in(record);
+                log.deltas.push_back(ReadDelta(in));
+                pos += DELTA_RECORD_HEADER_SIZE + size;
+            }
+            log.valid_size = pos;
+            return log;
+        }
+
+        // Каталог в редактируемом виде: объекты по именам, удаленные помечаются.
+        // Порядок объектов сохраняется, новые добавляются в конец
+        class CatalogueEditor {
+        public:
+            explicit CatalogueEditor(const transport::TransportCatalogue& catalogue) {
+                for (const Stop& stop : catalogue.GetStops()) {
+                    AddStop(stop.name, stop.coordinates);
+                }
+                for (const auto& [stops_pair, distance] : catalogue.GetAllStopPairDistances()) {
+                    distances_[{ stops_pair.first->id, stops_pair.second->id }] = distance;
+                }
+                std::vector<size_t> route;
+                for (const Bus& bus : catalogue.GetBuses()) {
+                    route.clear();
+                    for (const Stop* stop : catalogue.GetRoute(bus).Declared()) {
+                        route.push_back(stop->id);
+                    }
+                    AddBus(bus.name, route, bus.is_roundtrip);
+                }
+            }
+
+            void Apply(const Delta& delta) {
+                if (const auto* stop = std::get_if<StopDelta>(&delta.object)) {
+                    ApplyStop(delta.action, *stop);
+                }
+                else if (const auto* bus = std::get_if<BusDelta>(&delta.object)) {
+                    ApplyBus(delta.action, *bus);
+                }
+                else {
+                    ApplyDistance(delta.action, std::get<DistanceDelta>(delta.object));
+                }
+            }
+
+            transport::TransportCatalogue Build() const {
+                transport::TransportCatalogue catalogue;
+
+                std::vector<const Stop*> catalogue_stops(stops_.size(), nullptr);
+                for (size_t id = 0; id < stops_.size(); ++id) {
+                    if (!stops_[id].removed) {
+                        catalogue.AddStop({ stops_[id].name, stops_[id].coordinates });
+                        catalogue_stops[id] = &catalogue.GetStops().back();
+                    }
+                }
+                for (const auto& [stops_pair, distance] : distances_) {
+                    catalogue.AddStopPairDistances(catalogue_stops[stops_pair.first], catalogue_stops[stops_pair.second], distance);
+                }
+
+                std::vector<const Stop*> route;
+                for (const BusRecord& bus : buses_) {
+                    if (bus.removed) {
+                        continue;
+                    }
+                    route.clear();
+                    for (const size_t id : bus.stops) {
+                        route.push_back(catalogue_stops[id]);
+                    }
+                    catalogue.AddBus(bus.name, route, bus.is_roundtrip);
+                }
+                return catalogue;
+            }
+
+        private:
+            struct StopRecord {
+                std::string name;
+                geo::Coordinates coordinates;
+                size_t buses_count = 0;  // число маршрутов через остановку
+                bool removed = false;
+            };
+
+            struct BusRecord {
+                std::string name;
+                std::vector<size_t> stops;
+                bool is_roundtrip = false;
+                bool removed = false;
+            };
+
+            std::vector<StopRecord> stops_;
+            std::unordered_map<std::string, size_t> stop_ids_;  // только неудаленные
+            std::vector<BusRecord> buses_;
+            std::unordered_map<std::string, size_t> bus_ids_;  // только неудаленные
+            std::map<std::pair<size_t, size_t>, size_t> distances_;
+
+            void AddStop(const std::string& name, geo::Coordinates coordinates) {
+                stop_ids_[name] = stops_.size();
+                stops_.push_back({ name, coordinates });
+            }
+
+            void AddBus(const std::string& name, const std::vector<size_t>& route, bool is_roundtrip) {
+                bus_ids_[name] = buses_.size();
+                buses_.push_back({ name, route, is_roundtrip });
+                for (const size_t id : route) {
+                    ++stops_[id].buses_count;
+                }
+            }
+
+            void RemoveBus(size_t bus_id) {
+                BusRecord& bus = buses_[bus_id];
+                for (const size_t id : bus.stops) {
+                    --stops_[id].buses_count;
+                }
+                bus.removed = true;
+                bus_ids_.erase(bus.name);
+            }
+
+            size_t FindStop(const std::string& name) const {
+                const auto it = stop_ids_.find(name);
+                if (it == stop_ids_.end()) {
+                    throw DeltaError("Unknown stop "s + name);
+                }
+                return it->second;
+            }
+
+            void ApplyStop(DeltaAction action, const StopDelta& stop) {
+                const auto it = stop_ids_.find(stop.name);
+                if (action == DeltaAction::ADD) {
+                    if (it != stop_ids_.end()) {
+                        throw DeltaError("Stop "s + stop.name + " already exists"s);
+                    }
+                    AddStop(stop.name, stop.coordinates);
+                    return;
+                }
+
+                const size_t id = FindStop(stop.name);
+                if (action == DeltaAction::REPLACE) {
+                    stops_[id].coordinates = stop.coordinates;
+                    return;
+                }
+
+                if (stops_[id].buses_count > 0) {
+                    throw DeltaError("Stop "s + stop.name + " is used by buses"s);
+                }
+                for (auto it_distance = distances_.begin(); it_distance != distances_.end();) {
+                    if (it_distance->first.first == id || it_distance->first.second == id) {
+                        it_distance = distances_.erase(it_distance);
+                    }
+                    else {
+                        ++it_distance;
+                    }
+                }
+                stops_[id].removed = true;
+                stop_ids_.erase(stop.name);
+            }
+
+            void ApplyBus(DeltaAction action, const BusDelta& bus) {
+                const auto it = bus_ids_.find(bus.name);
+                if (action == DeltaAction::ADD && it != bus_ids_.end()) {
+                    throw DeltaError("Bus "s + bus.name + " already exists"s);
+                }
+                if (action != DeltaAction::ADD && it == bus_ids_.end()) {
+                    throw DeltaError("Unknown bus "s + bus.name);
+                }
+
+                std::vector<size_t> route;
+                if (action != DeltaAction::REMOVE) {
+                    route.reserve(bus.stops.size());
+                    for (const std::string& stop : bus.stops) {
+                        route.push_back(FindStop(stop));
+                    }
+                }
+
+                if (action == DeltaAction::REMOVE) {
+                    RemoveBus(it->second);
+                }
+                else if (action == DeltaAction::REPLACE) {
+                    // замененный маршрут остается на своем месте в порядке добавления
+                    BusRecord& record = buses_[it->second];
+                    for (const size_t id : record.stops) {
+                        --stops_[id].buses_count;
+                    }
+                    for (const size_t id : route) {
+                        ++stops_[id].buses_count;
+                    }
+                    record.stops = std::move(route);
+                    record.is_roundtrip = bus.is_roundtrip;
+                }
+                else {
+                    AddBus(bus.name, route, bus.is_roundtrip);
+                }
+            }
+
+            void ApplyDistance(DeltaAction action, const DistanceDelta& distance) {
+                const std::pair<size_t, size_t> stops_pair = { FindStop(distance.from), FindStop(distance.to) };
+                const auto it = distances_.find(stops_pair);
+                if (action == DeltaAction::ADD && it != distances_.end()) {
+                    throw DeltaError("Distance from "s + distance.from + " to "s + distance.to + " already exists"s);
+                }
+                if (action != DeltaAction::ADD && it == distances_.end()) {
+                    throw DeltaError("Unknown distance from "s + distance.from + " to "s + distance.to);
+                }
+
+                if (action == DeltaAction::REMOVE) {
+                    distances_.erase(it);
+                }
+                else {
+                    distances_[stops_pair] = distance.distance;
+                }
+            }
+        };
+
+    }  // namespace
+
+    void AppendDeltas(const SerializationSettings& settings, const std::vector<Delta>& deltas) {
+        const TransportBase base = LoadTransportBase(settings);
+        const DeltaLog log = ReadDeltaLog(settings.delta_file, base.checksum);
+
+        // новые изменения должны применяться после уже записанных
+        CatalogueEditor editor(base.catalogue);
+        for (const Delta& delta : log.deltas) {
+            editor.Apply(delta);
+        }
+        for (const Delta& delta : deltas) {
+            editor.Apply(delta);
+        }
+
+        Writer out;
+        if (log.valid_size == 0) {
+            out.Data().append(DELTA_MAGIC, sizeof(DELTA_MAGIC));
+            out.WriteUInt(DELTA_FORMAT_VERSION, 4);
+            out.WriteUInt(0, 4);  // зарезервировано
+            out.WriteUInt(base.checksum);
+        }
+        for (const Delta& delta : deltas) {
+            Writer record;
+            WriteDelta(record, delta);
+            out.WriteUInt(record.Data().size(), 4);
+            out.WriteUInt(ComputeChecksum(record.Data()));
+            out.Data().append(record.Data());
+        }
+
+        // недописанный при прошлом сбое хвост отбрасывается
+        if (std::filesystem::exists(settings.delta_file)) {
+            std::filesystem::resize_file(settings.delta_file, log.valid_size);
+        }
+        std::ofstream output(settings.delta_file, std::ios::binary | std::ios::app);
+        output.write(out.Data().data(), out.Data().size());
+        output.close();
+        if (!output) {
+            throw std::runtime_error("Failed to write delta log "s + settings.delta_file.string());
+        }
+    }
+
+    std::vector<Delta> LoadDeltas(const SerializationSettings& settings, const TransportBase& base) {
+        return ReadDeltaLog(settings.delta_file, base.checksum).deltas;
+    }
+
+    transport::TransportCatalogue ApplyDeltas(const transport::TransportCatalogue& catalogue, const std::vector<Delta>& deltas) {
+        CatalogueEditor editor(catalogue);
+        for (const Delta& delta : deltas) {
+            editor.Apply(delta);
+        }
+        return editor.Build();
+    }
+
+    std::shared_ptr<const transport::Snapshot> LoadSnapshot(const SerializationSettings& settings, uint64_t* base_checksum) {
+        TransportBase base = LoadTransportBase(settings);
+        const std::vector<Delta> deltas = LoadDeltas(settings, base);
+        if (base_checksum) {
+            *base_checksum = base.checksum;
+        }
+
+        // граф и таблица маршрутов базы отдаются маршрутизатору, когда он понадобится
+        auto base_graph = std::make_shared<graph::DirectedWeightedGraph<double>>(std::move(base.graph));
+        const auto snapshot = std::make_shared<const transport::Snapshot>(
+            std::move(base.catalogue),
+            [render_settings = std::move(base.render_settings)](const transport::TransportCatalogue& catalogue) {
+                return renderer::MapRenderer(renderer::RenderSettings(render_settings), catalogue);
+            },
+            [router_settings = base.router_settings, base_graph = std::move(base_graph), routes = base.routes_internal_data](
+                const transport::TransportCatalogue& catalogue) {
+                return std::make_unique<const transport::Router>(router_settings, std::move(*base_graph), routes, catalogue);
+            },
+            0, std::move(base.image));
+        if (deltas.empty()) {
+            return snapshot;
+        }
+        return snapshot->Update(ApplyDeltas(snapshot->GetCatalogue(), deltas), deltas.size());
+    }
+
+    std::shared_ptr<const transport::Snapshot> UpdateSnapshot(const SerializationSettings& settings, uint64_t base_checksum,
+                                                              std::shared_ptr<const transport::Snapshot> snapshot) {
+        std::vector<Delta> deltas = ReadDeltaLog(settings.delta_file, base_checksum).deltas;
+        if (deltas.size() <= snapshot->GetVersion()) {
+            return snapshot;
+        }
+        const size_t version = deltas.size();
+        deltas.erase(deltas.begin(), deltas.begin() + snapshot->GetVersion());
+        return snapshot->Update(ApplyDeltas(snapshot->GetCatalogue(), deltas), version);
+    }
+
+}  // namespace serialization
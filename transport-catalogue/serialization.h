@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "graph.h"
+#include "map_renderer.h"
+#include "router.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "transport_snapshot.h"
+
+namespace serialization {
+
+    struct SerializationSettings {
+        std::filesystem::path file;
+        std::filesystem::path delta_file;  // журнал изменений базы
+    };
+
+    // Файл базы не удалось прочитать: его нет, это другой формат или версия, данные повреждены
+    class SnapshotError : public std::runtime_error {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+    class MappedFile;
+
+    // Содержимое файла базы. graph::Router хранит ссылку на граф, поэтому маршрутизатор
+    // не хранится здесь целиком: вызывающий код собирает transport::Router на месте.
+    // Таблица маршрутов не копируется, а указывает в отображенный в память файл image
+    struct TransportBase {
+        transport::TransportCatalogue catalogue;
+        renderer::RenderSettings render_settings;
+        transport::RouterSettings router_settings;
+        graph::DirectedWeightedGraph<double> graph;
+        graph::Router<double>::RoutesInternalData routes_internal_data{ nullptr, nullptr };
+        std::shared_ptr<const MappedFile> image;
+        uint64_t checksum = 0;  // контрольная сумма метаданных, по ней журнал изменений привязан к базе
+    };
+
+    // Сохраняет каталог, настройки отрисовки и маршрутизации, граф и рассчитанные маршруты.
+    // Файл сначала пишется во временный и затем переименовывается, чтобы не оставить недописанную базу
+    void SaveTransportBase(const SerializationSettings& settings, const transport::Snapshot& snapshot);
+
+    TransportBase LoadTransportBase(const SerializationSettings& settings);
+
+    // Снимок по файлу базы с примененным журналом изменений. Версия снимка - число примененных изменений,
+    // таблица маршрутов базы используется из файла на месте, пока изменения ее не затронут.
+    // В base_checksum, если он задан, записывается контрольная сумма базы для UpdateSnapshot
+    std::shared_ptr<const transport::Snapshot> LoadSnapshot(const SerializationSettings& settings, uint64_t* base_checksum = nullptr);
+
+    // Следующая версия snapshot с изменениями, дописанными в журнал после него: применяются записи с номерами
+    // от версии снимка. base_checksum - контрольная сумма базы снимка. Без новых изменений возвращается snapshot
+    std::shared_ptr<const transport::Snapshot> UpdateSnapshot(const SerializationSettings& settings, uint64_t base_checksum,
+                                                              std::shared_ptr<const transport::Snapshot> snapshot);
+
+    // ---------------- таблицы шардов ----------------
+
+    // таблица шарда i лежит в файле file.i
+    struct ShardingSettings {
+        std::filesystem::path file;
+        size_t shard_count = 1;
+    };
+
+    // Контрольная сумма исходных данных маршрутизации (каталога и настроек). Шарды строятся
+    // разными процессами, по ней проверяется, что все таблицы построены по одним данным
+    uint64_t ComputeRoutingChecksum(const transport::TransportCatalogue& catalogue, const transport::RouterSettings& settings);
+
+    void SaveShardRoutes(const ShardingSettings& settings, size_t shard, uint64_t routing_checksum,
+                         graph::Router<double>::RoutesInternalData routes);
+
+    // таблица шарда, отображенная в память; image держит память таблицы
+    struct ShardRoutes {
+        graph::Router<double>::RoutesInternalData routes{ nullptr, nullptr };
+        std::shared_ptr<const MappedFile> image;
+    };
+
+    ShardRoutes LoadShardRoutes(const ShardingSettings& settings, size_t shard, uint64_t routing_checksum);
+
+    // оверлей шардов лежит в файле file.overlay
+    void SaveShardOverlay(const ShardingSettings& settings, uint64_t routing_checksum,
+                          const graph::ShardedRouter<double>::Overlay& overlay);
+
+    // ребра оверлея и его таблица маршрутов, отображенная в память; image держит память таблицы
+    struct ShardOverlay {
+        std::vector<graph::ShardedRouter<double>::OverlayEdge> edges;
+        graph::Router<double>::RoutesInternalData routes{ nullptr, nullptr };
+        std::shared_ptr<const MappedFile> image;
+    };
+
+    ShardOverlay LoadShardOverlay(const ShardingSettings& settings, uint64_t routing_checksum);
+
+    // ---------------- журнал изменений ----------------
+
+    enum class DeltaAction : uint8_t {
+        ADD,      // объекта еще нет в каталоге
+        REPLACE,  // объект есть и заменяется целиком
+        REMOVE    // объект есть и удаляется
+    };
+
+    struct StopDelta {
+        std::string name;
+        geo::Coordinates coordinates;
+    };
+
+    struct BusDelta {
+        std::string name;
+        std::vector<std::string> stops;  // в объявленном направлении, как в base_requests
+        bool is_roundtrip = false;
+    };
+
+    struct DistanceDelta {
+        std::string from;
+        std::string to;
+        size_t distance = 0;
+    };
+
+    struct Delta {
+        DeltaAction action = DeltaAction::ADD;
+        std::variant<StopDelta, BusDelta, DistanceDelta> object;
+    };
+
+    // Изменение нельзя применить к каталогу: объект уже есть или его нет,
+    // маршрут ссылается на неизвестную остановку, удаляемая остановка есть в маршрутах
+    class DeltaError : public std::runtime_error {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+    // Журнал изменений только дописывается. Каждая запись защищена своей контрольной суммой,
+    // недописанная последняя запись (сбой во время записи) отбрасывается при следующей дозаписи.
+    // Изменения проверяются на каталоге базы с уже записанными изменениями и попадают в журнал,
+    // только если применимы все
+    void AppendDeltas(const SerializationSettings& settings, const std::vector<Delta>& deltas);
+
+    // изменения из журнала базы по порядку записи; пусто, если журнала нет
+    std::vector<Delta> LoadDeltas(const SerializationSettings& settings, const TransportBase& base);
+
+    // каталог catalogue с примененными изменениями
+    transport::TransportCatalogue ApplyDeltas(const transport::TransportCatalogue& catalogue, const std::vector<Delta>& deltas);
+
+}  // namespace serialization
@@ -0,0 +1,555 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Поездка на одном рейсе: в графе есть ребро от каждой ее остановки до каждой следующей.
+    // Ребро от i-й до j-й остановки (i < j) ведет из from_vertices[i] в to_vertices[j]
+    struct Ride {
+        std::vector<VertexId> from_vertices;
+        std::vector<VertexId> to_vertices;
+        std::vector<EdgeId> edges;  // по парам i < j: сначала пары с i = 0, затем с i = 1 и т.д.
+
+        size_t size() const {
+            return from_vertices.size();
+        }
+
+        EdgeId GetEdge(size_t from, size_t to) const {
+            return edges[from * (2 * size() - from - 1) / 2 + (to - from - 1)];
+        }
+    };
+
+    // Кратчайшие маршруты в графе, вершины которого разбиты на шарды.
+    //
+    // Поездка, пересекающая границу, разрезается по перегонам между шардами: в шарде для каждого
+    // куска поездки между первой и последней его остановками заводятся вершины "в пути": выход
+    // (после последней остановки куска) и вход (перед первой), с ребрами посадки до выхода, от входа
+    // до высадки и от входа до выхода. Ребра поездки между шардами в шарды не попадают, а в оверлее
+    // остается по одному ребру на перегон между шардами. Пешие переходы между шардами идут в оверлей
+    // как есть. Граничные вершины шарда - выходы и входы поездок и концы пеших переходов между шардами.
+    //
+    // Таблица маршрутов шарда строится независимо от остальных (BuildShardRoutes). Оверлей - граф на
+    // граничных вершинах всех шардов с ребрами между шардами и кратчайшими путями внутри шарда от его
+    // входов до выходов - строится вместе с таблицей один раз (BuildOverlay) и загружается готовым.
+    // Маршрут из s в t - путь внутри шарда либо путь до выхода шарда s, путь по оверлею и путь от
+    // входа шарда t; куски поездки в нем склеиваются обратно в ребра исходного графа. Вес совпадает
+    // с весом маршрута по всему графу с точностью до округления: части складываются в другом порядке.
+    // Из маршрутов равного веса может быть выбран другой, чем у Router по всему графу.
+    //
+    // Память: таблица шарда - (V_s + R_s)^2 записей, где V_s - вершины шарда, R_s - вершины "в пути"
+    // (не больше двух на перегон поездки через границу шарда), таблица оверлея - B^2, где B - число
+    // граничных вершин: около двух на каждый перегон между шардами плюс концы пеших переходов через
+    // границу. B растет с числом рейсов, пересекающих границы, а не с размером шардов. Таблицы
+    // отображаются из файлов, в памяти оказываются только прочитанные страницы. Запрос перебирает
+    // выходы шарда s и входы шарда t: |выходы(s)| * |входы(t)| обращений к таблице оверлея
+    template <typename Weight>
+    class ShardedRouter {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using LocalRouter = Router<Weight>;
+
+    public:
+        using RouteInfo = typename LocalRouter::RouteInfo;
+        using RouteInternalData = typename LocalRouter::RouteInternalData;
+        using RoutesInternalData = typename LocalRouter::RoutesInternalData;
+
+        // Ребро оверлея и то, во что оно разворачивается в маршруте
+        struct OverlayEdge {
+            enum class Kind : uint8_t {
+                GRAPH,     // ребро графа id между шардами (пеший переход)
+                CROSSING,  // перегон поездки id от ее остановки first до first + 1 в другом шарде
+                SHORTCUT   // кратчайший путь внутри шарда id от локальной вершины first до second
+            };
+
+            VertexId from = 0;
+            VertexId to = 0;
+            Weight weight{};
+            Kind kind = Kind::GRAPH;
+            size_t id = 0;
+            size_t first = 0;
+            size_t second = 0;
+        };
+
+        struct Overlay {
+            std::vector<OverlayEdge> edges;
+            std::vector<RouteInternalData> routes;
+        };
+
+        // vertex_shards[v] - шард вершины v; rides - поездки графа; shard_routes[i] - таблица шарда i,
+        // построенная BuildShardRoutes; overlay_edges и overlay_routes - оверлей, построенный BuildOverlay.
+        // Таблицы не копируются и должны жить дольше маршрутизатора
+        ShardedRouter(const Graph& graph, std::vector<size_t> vertex_shards, std::vector<Ride> rides,
+                      const std::vector<RoutesInternalData>& shard_routes,
+                      std::vector<OverlayEdge> overlay_edges, RoutesInternalData overlay_routes);
+
+        // таблица маршрутов внутри шарда shard
+        static std::vector<RouteInternalData> BuildShardRoutes(const Graph& graph, const std::vector<size_t>& vertex_shards,
+                                                               const std::vector<Ride>& rides, size_t shard);
+
+        // оверлей для shard_count шардов; таблицы шардов для него не нужны
+        static Overlay BuildOverlay(const Graph& graph, const std::vector<size_t>& vertex_shards,
+                                    const std::vector<Ride>& rides, size_t shard_count);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    private:
+        // Ребро графа шарда: ребро исходного графа (edge) или кусок поездки ride от остановки from до to.
+        // Кусок, начинающийся посадкой (boards) и заканчивающийся высадкой (alights), в маршруте
+        // склеивается с предыдущими кусками в одно ребро поездки
+        struct Step {
+            EdgeId edge = NO_EDGE;
+            size_t ride = 0;
+            size_t from = 0;
+            size_t to = 0;
+            bool boards = false;
+            bool alights = false;
+        };
+
+        struct Shard {
+            std::vector<VertexId> vertices;  // вершины графа по локальным номерам, по возрастанию; вершины "в пути" - после них
+            std::vector<Step> steps;  // по локальным номерам ребер
+            Graph graph;
+            std::vector<VertexId> exits;  // локальные номера граничных вершин, из которых ребра оверлея ведут наружу
+            std::vector<VertexId> entries;  // и в которые они ведут снаружи
+            std::map<std::pair<size_t, size_t>, VertexId> ride_exits;  // (поездка, последняя остановка куска) -> выход
+            std::map<std::pair<size_t, size_t>, VertexId> ride_entries;  // (поездка, первая остановка куска) -> вход
+            std::unique_ptr<LocalRouter> router;
+        };
+
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+        static Shard MakeShard(const Graph& graph, const std::vector<size_t>& vertex_shards,
+                               const std::vector<VertexId>& local_ids, const std::vector<Ride>& rides, size_t shard);
+
+        static std::vector<VertexId> MakeLocalIds(const std::vector<size_t>& vertex_shards);
+
+        // ребра поездок; ребра поездок между шардами заменяются кусками и перегонами
+        static std::vector<bool> RideEdges(const Graph& graph, const std::vector<Ride>& rides);
+
+        // номера граничных вершин шардов в оверлее: по шардам, внутри шарда по локальным номерам
+        static std::vector<std::vector<VertexId>> MakeOverlayIds(const std::deque<Shard>& shards, size_t& overlay_size);
+
+        // веса кратчайших путей от from до всех вершин (алгоритм Дейкстры); nullopt - пути нет
+        static std::vector<std::optional<Weight>> ComputeWeights(const Graph& graph, VertexId from);
+
+        void AppendLocalSteps(size_t shard, VertexId from, VertexId to, std::vector<Step>& steps) const;
+
+        const Graph& graph_;
+        std::vector<size_t> vertex_shards_;
+        std::vector<Ride> rides_;
+        std::vector<VertexId> local_ids_;  // номер вершины в ее шарде
+        std::deque<Shard> shards_;  // маршрутизаторы шардов ссылаются на их графы, адреса не должны меняться
+
+        std::vector<std::vector<VertexId>> overlay_ids_;  // по шарду и локальному номеру: номер в оверлее или NO_VERTEX
+        std::vector<OverlayEdge> overlay_edges_;
+        Graph overlay_graph_;
+        std::unique_ptr<LocalRouter> overlay_router_;
+    };
+
+    template <typename Weight>
+    std::vector<VertexId> ShardedRouter<Weight>::MakeLocalIds(const std::vector<size_t>& vertex_shards) {
+        std::vector<VertexId> local_ids(vertex_shards.size());
+        std::vector<VertexId> shard_sizes;
+        for (VertexId vertex = 0; vertex < vertex_shards.size(); ++vertex) {
+            if (vertex_shards[vertex] >= shard_sizes.size()) {
+                shard_sizes.resize(vertex_shards[vertex] + 1, 0);
+            }
+            local_ids[vertex] = shard_sizes[vertex_shards[vertex]]++;
+        }
+        return local_ids;
+    }
+
+    template <typename Weight>
+    std::vector<bool> ShardedRouter<Weight>::RideEdges(const Graph& graph, const std::vector<Ride>& rides) {
+        std::vector<bool> ride_edges(graph.GetEdgeCount(), false);
+        for (const Ride& ride : rides) {
+            if (ride.to_vertices.size() != ride.size() || ride.edges.size() != ride.size() * (ride.size() - 1) / 2) {
+                throw std::invalid_argument("Ride doesn't match its stops");
+            }
+            for (const EdgeId edge_id : ride.edges) {
+                ride_edges.at(edge_id) = true;
+            }
+        }
+        return ride_edges;
+    }
+
+    template <typename Weight>
+    typename ShardedRouter<Weight>::Shard ShardedRouter<Weight>::MakeShard(const Graph& graph, const std::vector<size_t>& vertex_shards,
+                                                                           const std::vector<VertexId>& local_ids,
+                                                                           const std::vector<Ride>& rides, size_t shard) {
+        if (vertex_shards.size() != graph.GetVertexCount()) {
+            throw std::invalid_argument("Shards don't match the graph");
+        }
+
+        Shard result;
+        for (VertexId vertex = 0; vertex < vertex_shards.size(); ++vertex) {
+            if (vertex_shards[vertex] == shard) {
+                result.vertices.push_back(vertex);
+            }
+        }
+
+        // куски поездок в шарде: [first, last] - остановки подряд в этом шарде
+        struct Piece {
+            size_t ride;
+            size_t first;
+            size_t last;
+        };
+        std::vector<Piece> pieces;
+        VertexId vertex_count = result.vertices.size();
+        for (size_t ride_id = 0; ride_id < rides.size(); ++ride_id) {
+            const Ride& ride = rides[ride_id];
+            for (size_t first = 0; first < ride.size();) {
+                size_t last = first;
+                const size_t piece_shard = vertex_shards.at(ride.from_vertices[first]);
+                while (last + 1 < ride.size() && vertex_shards.at(ride.from_vertices[last + 1]) == piece_shard) {
+                    ++last;
+                }
+                // поездка целиком внутри шарда обходится ребрами графа
+                if (piece_shard == shard && (first > 0 || last + 1 < ride.size())) {
+                    pieces.push_back({ ride_id, first, last });
+                    vertex_count += (first > 0) + (last + 1 < ride.size());
+                }
+                first = last + 1;
+            }
+        }
+
+        result.graph = Graph(vertex_count);
+        const std::vector<bool> ride_edges = RideEdges(graph, rides);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            const bool from_inside = vertex_shards[edge.from] == shard;
+            const bool to_inside = vertex_shards[edge.to] == shard;
+            if (from_inside && to_inside) {
+                // имя ребра не нужно: маршрут восстанавливается в ребрах исходного графа
+                result.graph.AddEdge({ {}, edge.quality, local_ids[edge.from], local_ids[edge.to], edge.weight, edge.type });
+                result.steps.push_back({ edge_id });
+            }
+            else if (ride_edges[edge_id]) {
+                continue;
+            }
+            else if (from_inside) {
+                result.exits.push_back(local_ids[edge.from]);
+            }
+            else if (to_inside) {
+                result.entries.push_back(local_ids[edge.to]);
+            }
+        }
+
+        // вес части поездки от остановки from до to; от остановки до нее самой - ноль
+        const auto ride_weight = [&graph, &rides](size_t ride_id, size_t from, size_t to) {
+            return from == to ? Weight{} : graph.GetEdge(rides[ride_id].GetEdge(from, to)).weight;
+        };
+        const auto add_step = [&result](VertexId from, VertexId to, Weight weight, const Step& step) {
+            result.graph.AddEdge({ {}, 0, from, to, weight });
+            result.steps.push_back(step);
+        };
+
+        VertexId next_vertex = result.vertices.size();
+        for (const auto& [ride_id, first, last] : pieces) {
+            const Ride& ride = rides[ride_id];
+            VertexId exit = NO_VERTEX;
+            VertexId entry = NO_VERTEX;
+            if (last + 1 < ride.size()) {
+                exit = next_vertex++;
+                result.ride_exits[{ ride_id, last }] = exit;
+                result.exits.push_back(exit);
+                for (size_t stop = first; stop <= last; ++stop) {
+                    add_step(local_ids[ride.from_vertices[stop]], exit, ride_weight(ride_id, stop, last),
+                             { NO_EDGE, ride_id, stop, last, true, false });
+                }
+            }
+            if (first > 0) {
+                entry = next_vertex++;
+                result.ride_entries[{ ride_id, first }] = entry;
+                result.entries.push_back(entry);
+                for (size_t stop = first; stop <= last; ++stop) {
+                    add_step(entry, local_ids[ride.to_vertices[stop]], ride_weight(ride_id, first, stop),
+                             { NO_EDGE, ride_id, first, stop, false, true });
+                }
+            }
+            if (exit != NO_VERTEX && entry != NO_VERTEX) {
+                add_step(entry, exit, ride_weight(ride_id, first, last), { NO_EDGE, ride_id, first, last, false, false });
+            }
+        }
+
+        for (auto* boundary : { &result.exits, &result.entries }) {
+            std::sort(boundary->begin(), boundary->end());
+            boundary->erase(std::unique(boundary->begin(), boundary->end()), boundary->end());
+        }
+        return result;
+    }
+
+    template <typename Weight>
+    std::vector<typename ShardedRouter<Weight>::RouteInternalData> ShardedRouter<Weight>::BuildShardRoutes(
+        const Graph& graph, const std::vector<size_t>& vertex_shards, const std::vector<Ride>& rides, size_t shard) {
+        const Shard local = MakeShard(graph, vertex_shards, MakeLocalIds(vertex_shards), rides, shard);
+        return LocalRouter(local.graph).ReleaseRoutesInternalData();
+    }
+
+    template <typename Weight>
+    std::vector<std::vector<VertexId>> ShardedRouter<Weight>::MakeOverlayIds(const std::deque<Shard>& shards, size_t& overlay_size) {
+        std::vector<std::vector<VertexId>> overlay_ids;
+        overlay_size = 0;
+        for (const Shard& shard : shards) {
+            std::vector<VertexId>& ids = overlay_ids.emplace_back(shard.graph.GetVertexCount(), NO_VERTEX);
+            for (const auto* boundary : { &shard.exits, &shard.entries }) {
+                for (const VertexId vertex : *boundary) {
+                    ids[vertex] = 0;
+                }
+            }
+            for (VertexId& id : ids) {
+                if (id != NO_VERTEX) {
+                    id = overlay_size++;
+                }
+            }
+        }
+        return overlay_ids;
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<Weight>> ShardedRouter<Weight>::ComputeWeights(const Graph& graph, VertexId from) {
+        using Item = std::pair<Weight, VertexId>;
+        std::vector<std::optional<Weight>> weights(graph.GetVertexCount());
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+        weights[from] = Weight{};
+        queue.push({ Weight{}, from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (*weights[vertex] < weight) {
+                continue;
+            }
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                const Weight candidate = weight + edge.weight;
+                if (!weights[edge.to] || candidate < *weights[edge.to]) {
+                    weights[edge.to] = candidate;
+                    queue.push({ candidate, edge.to });
+                }
+            }
+        }
+        return weights;
+    }
+
+    template <typename Weight>
+    typename ShardedRouter<Weight>::Overlay ShardedRouter<Weight>::BuildOverlay(const Graph& graph, const std::vector<size_t>& vertex_shards,
+                                                                               const std::vector<Ride>& rides, size_t shard_count) {
+        const std::vector<VertexId> local_ids = MakeLocalIds(vertex_shards);
+        std::deque<Shard> shards;
+        for (size_t shard = 0; shard < shard_count; ++shard) {
+            shards.push_back(MakeShard(graph, vertex_shards, local_ids, rides, shard));
+        }
+        size_t overlay_size = 0;
+        const std::vector<std::vector<VertexId>> overlay_ids = MakeOverlayIds(shards, overlay_size);
+
+        Overlay overlay;
+        const std::vector<bool> ride_edges = RideEdges(graph, rides);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            const size_t shard_from = vertex_shards[edge.from];
+            const size_t shard_to = vertex_shards[edge.to];
+            if (shard_from != shard_to && !ride_edges[edge_id]) {
+                overlay.edges.push_back({ overlay_ids[shard_from][local_ids[edge.from]], overlay_ids[shard_to][local_ids[edge.to]],
+                                          edge.weight, OverlayEdge::Kind::GRAPH, edge_id });
+            }
+        }
+        for (size_t ride_id = 0; ride_id < rides.size(); ++ride_id) {
+            const Ride& ride = rides[ride_id];
+            for (size_t stop = 0; stop + 1 < ride.size(); ++stop) {
+                const size_t shard_from = vertex_shards[ride.from_vertices[stop]];
+                const size_t shard_to = vertex_shards[ride.from_vertices[stop + 1]];
+                if (shard_from != shard_to) {
+                    overlay.edges.push_back({ overlay_ids[shard_from][shards[shard_from].ride_exits.at({ ride_id, stop })],
+                                              overlay_ids[shard_to][shards[shard_to].ride_entries.at({ ride_id, stop + 1 })],
+                                              graph.GetEdge(ride.GetEdge(stop, stop + 1)).weight,
+                                              OverlayEdge::Kind::CROSSING, ride_id, stop });
+                }
+            }
+        }
+        for (size_t shard = 0; shard < shard_count; ++shard) {
+            const Shard& local = shards[shard];
+            for (const VertexId entry : local.entries) {
+                const auto weights = ComputeWeights(local.graph, entry);
+                for (const VertexId exit : local.exits) {
+                    if (exit != entry && weights[exit]) {
+                        overlay.edges.push_back({ overlay_ids[shard][entry], overlay_ids[shard][exit], *weights[exit],
+                                                  OverlayEdge::Kind::SHORTCUT, shard, entry, exit });
+                    }
+                }
+            }
+        }
+
+        Graph overlay_graph(overlay_size);
+        for (const OverlayEdge& edge : overlay.edges) {
+            overlay_graph.AddEdge({ {}, 0, edge.from, edge.to, edge.weight });
+        }
+        overlay.routes = LocalRouter(overlay_graph).ReleaseRoutesInternalData();
+        return overlay;
+    }
+
+    template <typename Weight>
+    ShardedRouter<Weight>::ShardedRouter(const Graph& graph, std::vector<size_t> vertex_shards, std::vector<Ride> rides,
+                                         const std::vector<RoutesInternalData>& shard_routes,
+                                         std::vector<OverlayEdge> overlay_edges, RoutesInternalData overlay_routes)
+        : graph_(graph)
+        , vertex_shards_(std::move(vertex_shards))
+        , rides_(std::move(rides))
+        , local_ids_(MakeLocalIds(vertex_shards_))
+        , overlay_edges_(std::move(overlay_edges))
+    {
+        for (size_t shard = 0; shard < shard_routes.size(); ++shard) {
+            shards_.push_back(MakeShard(graph_, vertex_shards_, local_ids_, rides_, shard));
+            Shard& local = shards_.back();
+            local.router = std::make_unique<LocalRouter>(local.graph, shard_routes[shard]);
+        }
+        for (const size_t shard : vertex_shards_) {
+            if (shard >= shards_.size()) {
+                throw std::invalid_argument("Shard routes are missing");
+            }
+        }
+
+        size_t overlay_size = 0;
+        overlay_ids_ = MakeOverlayIds(shards_, overlay_size);
+        overlay_graph_ = Graph(overlay_size);
+        for (const OverlayEdge& edge : overlay_edges_) {
+            bool valid = edge.from < overlay_size && edge.to < overlay_size;
+            switch (edge.kind) {
+            case OverlayEdge::Kind::GRAPH:
+                valid = valid && edge.id < graph_.GetEdgeCount();
+                break;
+            case OverlayEdge::Kind::CROSSING:
+                valid = valid && edge.id < rides_.size() && edge.first + 1 < rides_[edge.id].size();
+                break;
+            case OverlayEdge::Kind::SHORTCUT:
+                valid = valid && edge.id < shards_.size() && edge.first < shards_[edge.id].graph.GetVertexCount()
+                        && edge.second < shards_[edge.id].graph.GetVertexCount();
+                break;
+            }
+            if (!valid) {
+                throw std::invalid_argument("Overlay doesn't match the shards");
+            }
+            overlay_graph_.AddEdge({ {}, 0, edge.from, edge.to, edge.weight });
+        }
+        overlay_router_ = std::make_unique<LocalRouter>(overlay_graph_, overlay_routes);
+    }
+
+    template <typename Weight>
+    void ShardedRouter<Weight>::AppendLocalSteps(size_t shard, VertexId from, VertexId to, std::vector<Step>& steps) const {
+        const Shard& local = shards_[shard];
+        const auto route = local.router->BuildRoute(from, to);
+        for (const EdgeId edge_id : route->edges) {
+            steps.push_back(local.steps[edge_id]);
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ShardedRouter<Weight>::RouteInfo> ShardedRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        const size_t shard_from = vertex_shards_.at(from);
+        const size_t shard_to = vertex_shards_.at(to);
+        const Shard& local_from = shards_[shard_from];
+        const Shard& local_to = shards_[shard_to];
+        const VertexId local_from_id = local_ids_[from];
+        const VertexId local_to_id = local_ids_[to];
+
+        // лучший маршрут: внутри шарда (exit == NO_VERTEX) или через выход exit и вход entry
+        std::optional<Weight> best_weight;
+        VertexId best_exit = NO_VERTEX;
+        VertexId best_entry = NO_VERTEX;
+        if (shard_from == shard_to) {
+            best_weight = local_from.router->GetRouteWeight(local_from_id, local_to_id);
+        }
+
+        // пути от входов шарда t до t считаются один раз
+        std::vector<std::optional<Weight>> entry_weights;
+        entry_weights.reserve(local_to.entries.size());
+        for (const VertexId entry : local_to.entries) {
+            entry_weights.push_back(local_to.router->GetRouteWeight(entry, local_to_id));
+        }
+
+        for (const VertexId exit : local_from.exits) {
+            const auto exit_weight = local_from.router->GetRouteWeight(local_from_id, exit);
+            if (!exit_weight) {
+                continue;
+            }
+            const VertexId overlay_exit = overlay_ids_[shard_from][exit];
+            for (size_t i = 0; i < local_to.entries.size(); ++i) {
+                if (!entry_weights[i]) {
+                    continue;
+                }
+                const auto overlay_weight = overlay_router_->GetRouteWeight(overlay_exit, overlay_ids_[shard_to][local_to.entries[i]]);
+                if (!overlay_weight) {
+                    continue;
+                }
+                const Weight weight = *exit_weight + *overlay_weight + *entry_weights[i];
+                if (!best_weight || weight < *best_weight) {
+                    best_weight = weight;
+                    best_exit = exit;
+                    best_entry = local_to.entries[i];
+                }
+            }
+        }
+
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<Step> steps;
+        if (best_exit == NO_VERTEX) {
+            AppendLocalSteps(shard_from, local_from_id, local_to_id, steps);
+        }
+        else {
+            AppendLocalSteps(shard_from, local_from_id, best_exit, steps);
+            const auto overlay_route = overlay_router_->BuildRoute(overlay_ids_[shard_from][best_exit],
+                                                                   overlay_ids_[shard_to][best_entry]);
+            for (const EdgeId overlay_edge_id : overlay_route->edges) {
+                const OverlayEdge& overlay_edge = overlay_edges_[overlay_edge_id];
+                switch (overlay_edge.kind) {
+                case OverlayEdge::Kind::GRAPH:
+                    steps.push_back({ overlay_edge.id });
+                    break;
+                case OverlayEdge::Kind::CROSSING:
+                    steps.push_back({ NO_EDGE, overlay_edge.id, overlay_edge.first, overlay_edge.first + 1, false, false });
+                    break;
+                case OverlayEdge::Kind::SHORTCUT:
+                    AppendLocalSteps(overlay_edge.id, overlay_edge.first, overlay_edge.second, steps);
+                    break;
+                }
+            }
+            AppendLocalSteps(shard_to, best_entry, local_to_id, steps);
+        }
+
+        // куски поездки от посадки до высадки склеиваются в одно ребро поездки
+        std::vector<EdgeId> edges;
+        size_t boarding_stop = 0;
+        for (const Step& step : steps) {
+            if (step.edge != NO_EDGE) {
+                edges.push_back(step.edge);
+                continue;
+            }
+            if (step.boards) {
+                boarding_stop = step.from;
+            }
+            if (step.alights) {
+                edges.push_back(rides_[step.ride].GetEdge(boarding_stop, step.to));
+            }
+        }
+        return RouteInfo{ *best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
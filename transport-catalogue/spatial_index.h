@@ -0,0 +1,230 @@
+#pragma once
+
+#include "geo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace geo {
+
+    // Пространственный индекс точек земной поверхности (k-d дерево).
+    // Точки хранятся как единичные векторы в трехмерном пространстве: длина хорды между ними
+    // монотонно зависит от расстояния по большому кругу, поэтому ближайшие по хорде точки
+    // совпадают с ближайшими по поверхности, а отсечение ветвей дерева остается точным.
+    // Индекс строится один раз по всем точкам, запросы не выделяют память.
+    template <typename Item>
+    class SpatialIndex {
+    public:
+        struct Neighbor {
+            Item item;
+            double distance;  // расстояние по большому кругу в метрах
+        };
+
+        SpatialIndex() = default;
+
+        explicit SpatialIndex(const std::vector<std::pair<Coordinates, Item>>& points);
+
+        // count ближайших к center точек по возрастанию расстояния.
+        // result очищается и переиспользуется: при достаточной емкости память не выделяется
+        void FindNearest(Coordinates center, size_t count, std::vector<Neighbor>& result) const;
+
+        // все точки не дальше radius метров от center, в порядке обхода дерева
+        void FindWithinRadius(Coordinates center, double radius, std::vector<Neighbor>& result) const;
+
+        size_t size() const {
+            return nodes_.size();
+        }
+
+    private:
+        struct Point {
+            double x = 0;
+            double y = 0;
+            double z = 0;
+
+            double operator[](uint8_t axis) const {
+                return axis == 0 ? x : axis == 1 ? y : z;
+            }
+        };
+
+        // неявное сбалансированное дерево: узел диапазона [begin, end) лежит в его середине,
+        // левое поддерево - слева от него, правое - справа
+        struct Node {
+            Point point;
+            Item item;
+            uint8_t axis = 0;  // ось, по которой делится поддерево узла
+        };
+
+        std::vector<Node> nodes_;
+
+        static Point ToPoint(Coordinates coords) {
+            const double lat = coords.lat * DEGREES_TO_RADIANS;
+            const double lng = coords.lng * DEGREES_TO_RADIANS;
+            return { std::cos(lat) * std::cos(lng), std::cos(lat) * std::sin(lng), std::sin(lat) };
+        }
+
+        static double SquaredChord(const Point& lhs, const Point& rhs) {
+            const double dx = lhs.x - rhs.x;
+            const double dy = lhs.y - rhs.y;
+            const double dz = lhs.z - rhs.z;
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        // длина хорды единичной сферы в расстояние по большому кругу
+        static double ChordToDistance(double squared_chord) {
+            return 2 * std::asin(std::min(1.0, std::sqrt(squared_chord) / 2)) * EARTH_RADIUS;
+        }
+
+        static double DistanceToSquaredChord(double distance) {
+            const double chord = 2 * std::sin(std::min(180 * DEGREES_TO_RADIANS, distance / EARTH_RADIUS) / 2);
+            return chord * chord;
+        }
+
+        static bool ByDistance(const Neighbor& lhs, const Neighbor& rhs) {
+            return lhs.distance < rhs.distance;
+        }
+
+        void Build(size_t begin, size_t end);
+
+        // во время поиска в поле distance лежит квадрат хорды
+        void SearchNearest(size_t begin, size_t end, const Point& center, size_t count, std::vector<Neighbor>& heap) const;
+        void SearchWithinRadius(size_t begin, size_t end, const Point& center, double squared_radius, std::vector<Neighbor>& result) const;
+    };
+
+    template <typename Item>
+    SpatialIndex<Item>::SpatialIndex(const std::vector<std::pair<Coordinates, Item>>& points) {
+        nodes_.reserve(points.size());
+        for (const auto& [coords, item] : points) {
+            nodes_.push_back({ ToPoint(coords), item, 0 });
+        }
+        Build(0, nodes_.size());
+    }
+
+    template <typename Item>
+    void SpatialIndex<Item>::Build(size_t begin, size_t end) {
+        if (end - begin < 2) {
+            return;
+        }
+
+        // делим по оси с наибольшим разбросом координат
+        Point min_point = nodes_[begin].point;
+        Point max_point = nodes_[begin].point;
+        for (size_t i = begin + 1; i < end; ++i) {
+            const Point& point = nodes_[i].point;
+            min_point = { std::min(min_point.x, point.x), std::min(min_point.y, point.y), std::min(min_point.z, point.z) };
+            max_point = { std::max(max_point.x, point.x), std::max(max_point.y, point.y), std::max(max_point.z, point.z) };
+        }
+        uint8_t axis = 0;
+        for (uint8_t candidate = 1; candidate < 3; ++candidate) {
+            if (max_point[candidate] - min_point[candidate] > max_point[axis] - min_point[axis]) {
+                axis = candidate;
+            }
+        }
+
+        const size_t middle = begin + (end - begin) / 2;
+        std::nth_element(nodes_.begin() + begin, nodes_.begin() + middle, nodes_.begin() + end,
+            [axis](const Node& lhs, const Node& rhs) {
+                return lhs.point[axis] < rhs.point[axis];
+            });
+        nodes_[middle].axis = axis;
+
+        Build(begin, middle);
+        Build(middle + 1, end);
+    }
+
+    template <typename Item>
+    void SpatialIndex<Item>::FindNearest(Coordinates center, size_t count, std::vector<Neighbor>& result) const {
+        result.clear();
+        if (count == 0) {
+            return;
+        }
+
+        // result используется как max-куча по расстоянию размером не больше count
+        SearchNearest(0, nodes_.size(), ToPoint(center), count, result);
+
+        std::sort_heap(result.begin(), result.end(), ByDistance);
+        for (Neighbor& neighbor : result) {
+            neighbor.distance = ChordToDistance(neighbor.distance);
+        }
+    }
+
+    template <typename Item>
+    void SpatialIndex<Item>::SearchNearest(size_t begin, size_t end, const Point& center, size_t count, std::vector<Neighbor>& heap) const {
+        if (begin >= end) {
+            return;
+        }
+
+        const size_t middle = begin + (end - begin) / 2;
+        const Node& node = nodes_[middle];
+
+        const double squared_chord = SquaredChord(node.point, center);
+        if (heap.size() < count) {
+            heap.push_back({ node.item, squared_chord });
+            std::push_heap(heap.begin(), heap.end(), ByDistance);
+        }
+        else if (squared_chord < heap.front().distance) {
+            std::pop_heap(heap.begin(), heap.end(), ByDistance);
+            heap.back() = { node.item, squared_chord };
+            std::push_heap(heap.begin(), heap.end(), ByDistance);
+        }
+
+        if (end - begin == 1) {
+            return;
+        }
+
+        // сначала спускаемся в половину с центром запроса, вторую смотрим, только если
+        // разделяющая плоскость ближе самого дальнего из найденных соседей
+        const double diff = center[node.axis] - node.point[node.axis];
+        const bool left_first = diff < 0;
+        if (left_first) {
+            SearchNearest(begin, middle, center, count, heap);
+        }
+        else {
+            SearchNearest(middle + 1, end, center, count, heap);
+        }
+
+        if (heap.size() < count || diff * diff < heap.front().distance) {
+            if (left_first) {
+                SearchNearest(middle + 1, end, center, count, heap);
+            }
+            else {
+                SearchNearest(begin, middle, center, count, heap);
+            }
+        }
+    }
+
+    template <typename Item>
+    void SpatialIndex<Item>::FindWithinRadius(Coordinates center, double radius, std::vector<Neighbor>& result) const {
+        result.clear();
+        SearchWithinRadius(0, nodes_.size(), ToPoint(center), DistanceToSquaredChord(radius), result);
+        for (Neighbor& neighbor : result) {
+            neighbor.distance = ChordToDistance(neighbor.distance);
+        }
+    }
+
+    template <typename Item>
+    void SpatialIndex<Item>::SearchWithinRadius(size_t begin, size_t end, const Point& center, double squared_radius, std::vector<Neighbor>& result) const {
+        if (begin >= end) {
+            return;
+        }
+
+        const size_t middle = begin + (end - begin) / 2;
+        const Node& node = nodes_[middle];
+
+        const double squared_chord = SquaredChord(node.point, center);
+        if (squared_chord <= squared_radius) {
+            result.push_back({ node.item, squared_chord });
+        }
+
+        const double diff = center[node.axis] - node.point[node.axis];
+        if (diff < 0 || diff * diff <= squared_radius) {
+            SearchWithinRadius(begin, middle, center, squared_radius, result);
+        }
+        if (diff >= 0 || diff * diff <= squared_radius) {
+            SearchWithinRadius(middle + 1, end, center, squared_radius, result);
+        }
+    }
+
+}  // namespace geo
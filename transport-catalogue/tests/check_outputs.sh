@@ -0,0 +1,26 @@
+#!/bin/bash
+# Отвечает на запросы каждого tests/*/input.json, рядом с которым лежит expected.json,
+# и сравнивает ответы с ожидаемыми байт в байт.
+#
+# usage: tests/check_outputs.sh <путь к transport_catalogue>
+set -eu
+
+TESTS_DIR=$(realpath "$(dirname "$0")")
+BINARY=$(realpath "$1")
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+status=0
+for expected in "$TESTS_DIR"/*/expected.json; do
+    case_dir=$(dirname "$expected")
+    name=$(basename "$case_dir")
+    "$BINARY" < "$case_dir/input.json" > "$WORK_DIR/$name.json"
+    if cmp -s "$WORK_DIR/$name.json" "$expected"; then
+        echo "$name: OK"
+    else
+        echo "$name: DIFF"
+        diff "$WORK_DIR/$name.json" "$expected" | head -20
+        status=1
+    fi
+done
+exit $status
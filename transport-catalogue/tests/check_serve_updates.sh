@@ -0,0 +1,56 @@
+#!/bin/bash
+# Проверяет, что serve_requests подхватывает изменения, дописанные update_base во время работы:
+# автобуса NEW сначала нет, после update_base ответ на тот же запрос должен появиться,
+# не дольше чем за несколько интервалов опроса журнала.
+#
+# usage: tests/check_serve_updates.sh <путь к transport_catalogue> [каталог с входами]
+set -eu
+
+BINARY=$(realpath "$1")
+CASE_DIR=$(realpath "${2:-$(dirname "$0")/degenerate_bus}")
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR"
+
+"$BINARY" make_base < "$CASE_DIR/make_base.json"
+SETTINGS=$(python3 -c 'import json, sys; print(json.dumps({"serialization_settings": json.load(open(sys.argv[1]))["serialization_settings"]}))' \
+    "$CASE_DIR/make_base.json")
+REQUEST='{"id": 1, "type": "Bus", "name": "NEW"}'
+
+coproc SERVER { "$BINARY" serve_requests; }
+echo "$SETTINGS" >&"${SERVER[1]}"
+
+echo "$REQUEST" >&"${SERVER[1]}"
+read -r -t 10 response <&"${SERVER[0]}"
+if [[ "$response" != *"not found"* ]]; then
+    echo "before update: unexpected response $response"
+    exit 1
+fi
+
+python3 - "$SETTINGS" > delta.json <<'PY'
+import json, sys
+doc = json.loads(sys.argv[1])
+doc["delta_requests"] = [{"action": "add", "type": "Bus", "name": "NEW", "stops": ["S1", "S2"], "is_roundtrip": False}]
+json.dump(doc, sys.stdout)
+PY
+"$BINARY" update_base < delta.json
+
+status=1
+for attempt in $(seq 50); do
+    echo "$REQUEST" >&"${SERVER[1]}"
+    read -r -t 10 response <&"${SERVER[0]}"
+    if [[ "$response" == *"stop_count"* ]]; then
+        status=0
+        break
+    fi
+    sleep 0.1
+done
+
+exec {SERVER[1]}>&-
+wait "$SERVER_PID" || status=1
+if [ $status -eq 0 ]; then
+    echo "serve updates: OK"
+else
+    echo "serve updates: no update, last response $response"
+fi
+exit $status
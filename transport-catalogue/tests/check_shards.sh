@@ -0,0 +1,53 @@
+#!/bin/bash
+# Строит таблицы шардов параллельными процессами make_shard, отвечает на запросы
+# process_shards и сравнивает ответы с ответами по всему графу (compare_responses.py).
+# Без входного JSON проверяются все tests/sharding/*.json.
+#
+# usage: tests/check_shards.sh <путь к transport_catalogue> [входной JSON] [числа шардов...]
+set -eu
+
+TESTS_DIR=$(realpath "$(dirname "$0")")
+BINARY=$(realpath "$1")
+if [ $# -ge 2 ]; then
+    INPUTS=("$(realpath "$2")")
+else
+    INPUTS=("$TESTS_DIR"/sharding/*.json)
+fi
+shift $(( $# < 2 ? $# : 2 ))
+SHARD_COUNTS=("${@:-1 2 3 4 5 7}")
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR"
+
+status=0
+for input in "${INPUTS[@]}"; do
+    name=$(basename "$input" .json)
+    "$BINARY" < "$input" > full.json
+
+    for shard_count in ${SHARD_COUNTS[@]}; do
+        python3 - "$input" "$shard_count" > input.json <<'EOF'
+import json, sys
+doc = json.load(open(sys.argv[1]))
+doc["sharding_settings"] = {"file": "routes.bin", "shard_count": int(sys.argv[2])}
+json.dump(doc, sys.stdout)
+EOF
+        rm -f routes.bin.*
+        pids=()
+        for ((shard = 0; shard < shard_count; ++shard)); do
+            "$BINARY" make_shard "$shard" < input.json &
+            pids+=($!)
+        done
+        for pid in "${pids[@]}"; do
+            wait "$pid"
+        done
+
+        "$BINARY" process_shards < input.json > sharded.json
+        if python3 "$TESTS_DIR/compare_responses.py" input.json full.json sharded.json; then
+            echo "$name shards=$shard_count: OK"
+        else
+            echo "$name shards=$shard_count: DIFF"
+            status=1
+        fi
+    done
+done
+exit $status
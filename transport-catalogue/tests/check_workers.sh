@@ -0,0 +1,37 @@
+#!/bin/bash
+# Сравнивает ответы process_requests, посчитанные рабочими процессами, с ответами
+# одного процесса. Ответы рабочих вставляются в вывод как есть, поэтому совпадать
+# должны байт в байт, в том числе nan кривизны у вырожденного маршрута.
+#
+# usage: tests/check_workers.sh <путь к transport_catalogue> [каталог с входами]
+set -eu
+
+BINARY=$(realpath "$1")
+CASE_DIR=$(realpath "${2:-$(dirname "$0")/degenerate_bus}")
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR"
+
+"$BINARY" make_base < "$CASE_DIR/make_base.json"
+
+status=0
+for compact in false true; do
+    for workers in 1 3; do
+        python3 - "$CASE_DIR/process_requests.json" "$workers" "$compact" > "requests_$workers.json" <<'EOF'
+import json, sys
+doc = json.load(open(sys.argv[1]))
+doc["worker_settings"] = {"workers": int(sys.argv[2]), "batch_size": 2}
+doc["output_settings"] = {"compact": sys.argv[3] == "true"}
+json.dump(doc, sys.stdout)
+EOF
+        "$BINARY" process_requests < "requests_$workers.json" > "responses_$workers.json"
+    done
+    if cmp -s responses_1.json responses_3.json; then
+        echo "compact=$compact: OK"
+    else
+        echo "compact=$compact: DIFF"
+        diff responses_1.json responses_3.json | head -20
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Сравнивает ответы process_shards с ответами по всему графу.
+# Маршрут по шардам складывает веса в другом порядке, поэтому total_time сравнивается
+# с относительной точностью, а из маршрутов равного веса может быть выбран другой:
+# у маршрута проверяется, что он начинается и заканчивается в нужных остановках и что
+# время его частей в сумме дает total_time. Остальные ответы должны совпадать точно.
+#
+# usage: compare_responses.py <запрос> <ответы по всему графу> <ответы по шардам>
+import json
+import math
+import sys
+
+REL_TOLERANCE = 1e-9
+
+
+def close(lhs, rhs):
+    return math.isclose(lhs, rhs, rel_tol=REL_TOLERANCE, abs_tol=REL_TOLERANCE)
+
+
+def check_route(request, expected, actual):
+    if "error_message" in expected or "error_message" in actual:
+        return expected == actual
+    if not close(expected["total_time"], actual["total_time"]):
+        return False
+    items = actual["items"]
+    if items:
+        # маршрут начинается ожиданием в исходной остановке или пешим переходом от нее;
+        # у Walk stop_name - остановка, куда идут, поэтому последний Walk ведет в конечную
+        first, last = items[0], items[-1]
+        if first["type"] == "Wait" and first["stop_name"] != request["from"]:
+            return False
+        if first["type"] not in ("Wait", "Walk"):
+            return False
+        if last["type"] == "Walk" and last["stop_name"] != request["to"]:
+            return False
+    return close(sum(item["time"] for item in items), actual["total_time"])
+
+
+def main():
+    requests = {request["id"]: request for request in json.load(open(sys.argv[1]))["stat_requests"]}
+    expected_responses = json.load(open(sys.argv[2]))
+    actual_responses = json.load(open(sys.argv[3]))
+    if len(expected_responses) != len(actual_responses):
+        print(f"{len(actual_responses)} responses instead of {len(expected_responses)}")
+        return 1
+
+    mismatches = 0
+    for expected, actual in zip(expected_responses, actual_responses):
+        request = requests[expected["request_id"]]
+        if actual.get("request_id") != expected["request_id"]:
+            ok = False
+        elif request["type"] == "Route":
+            ok = check_route(request, expected, actual)
+        else:
+            ok = expected == actual
+        if not ok:
+            mismatches += 1
+            print(json.dumps(expected)[:300])
+            print(json.dumps(actual)[:300])
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
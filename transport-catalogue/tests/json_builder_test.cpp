@@ -0,0 +1,81 @@
+// Проверка того, что json::Builder и As* временного узла переносят содержимое, а не копируют:
+// строка, переданная в Builder, оказывается в результате с тем же буфером.
+//
+// Собирается и запускается tests/run_unit_tests.sh
+#include "json.h"
+#include "json_builder.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace std::literals;
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: "sv << message << '\n';
+            ++failures;
+        }
+    }
+
+    // строка длиннее буфера короткой строки: ее символы лежат в куче, и по адресу видно, скопирована ли она
+    std::string MakeLongString() {
+        return std::string(1000, 'x');
+    }
+
+    void TestBuildAsDictMoves() {
+        std::string svg = MakeLongString();
+        const char* const chars = svg.data();
+
+        const json::Dict dict = json::Builder{}.StartDict().Key("map"s).Value(std::move(svg)).EndDict().Build().AsDict();
+        Check(dict.at("map"s).AsString().data() == chars, "Build().AsDict() keeps the string buffer"sv);
+    }
+
+    void TestSubBuilderMoves() {
+        std::string svg = MakeLongString();
+        const char* const chars = svg.data();
+        json::Node item = json::Builder{}.StartArray().Value(std::move(svg)).EndArray().Build();
+        const json::Node* const items = item.AsArray().data();
+
+        const json::Node result = json::Builder{}.StartArray().Value(std::move(item)).EndArray().Build();
+        const json::Array& appended = result.AsArray().at(0).AsArray();
+        Check(appended.data() == items, "appended Build() keeps the array buffer"sv);
+        Check(appended.at(0).AsString().data() == chars, "appended Build() keeps the string buffer"sv);
+    }
+
+    void TestAsStringMoves() {
+        std::string svg = MakeLongString();
+        const char* const chars = svg.data();
+
+        const std::string moved = json::Node(std::move(svg)).AsString();
+        Check(moved.data() == chars, "AsString() of a temporary keeps the buffer"sv);
+
+        const json::Node node(MakeLongString());
+        const std::string copied = node.AsString();
+        Check(copied.data() != node.AsString().data(), "AsString() of an lvalue copies"sv);
+    }
+
+    void TestStartArrayReserves() {
+        const json::Node node = json::Builder{}.StartArray(100).Value(1).EndArray().Build();
+        Check(node.AsArray().capacity() >= 100, "StartArray(capacity) reserves"sv);
+    }
+
+}  // namespace
+
+int main() {
+    TestBuildAsDictMoves();
+    TestSubBuilderMoves();
+    TestAsStringMoves();
+    TestStartArrayReserves();
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "json_builder_test: OK\n"sv;
+    return EXIT_SUCCESS;
+}
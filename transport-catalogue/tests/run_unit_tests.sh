@@ -0,0 +1,24 @@
+#!/bin/bash
+# Собирает каждый tests/*_test.cpp вместе с исходниками проекта (без main.cpp) и запускает его.
+#
+# usage: tests/run_unit_tests.sh [компилятор]
+set -eu
+
+TESTS_DIR=$(realpath "$(dirname "$0")")
+SOURCE_DIR=$(dirname "$TESTS_DIR")
+COMPILER=${1:-g++}
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+SOURCES=()
+for source in "$SOURCE_DIR"/*.cpp; do
+    [ "$(basename "$source")" = main.cpp ] || SOURCES+=("$source")
+done
+
+status=0
+for test in "$TESTS_DIR"/*_test.cpp; do
+    name=$(basename "$test" .cpp)
+    "$COMPILER" -std=c++17 -O2 -Wall -Wextra -pthread -I"$SOURCE_DIR" "$test" "${SOURCES[@]}" -o "$WORK_DIR/$name"
+    "$WORK_DIR/$name" || status=1
+done
+exit $status
@@ -0,0 +1,116 @@
+// Проверка SnapshotPublisher: публикуется только более новая версия, и при одновременной публикации
+// из нескольких потоков читатели никогда не видят, как версия уменьшается, а в конце опубликована
+// самая новая из версий.
+//
+// Собирается и запускается tests/run_unit_tests.sh
+#include "transport_snapshot.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    int failures = 0;
+
+    void Check(bool condition, std::string_view message) {
+        if (!condition) {
+            std::cerr << "FAILED: "sv << message << '\n';
+            ++failures;
+        }
+    }
+
+    std::shared_ptr<const transport::Snapshot> MakeSnapshot(uint64_t version) {
+        return std::make_shared<const transport::Snapshot>(transport::TransportCatalogue{}, nullptr, nullptr, version);
+    }
+
+    void TestVersionCheck() {
+        transport::SnapshotPublisher publisher(MakeSnapshot(5));
+        Check(!publisher.Publish(MakeSnapshot(4)), "older version is not published"sv);
+        Check(!publisher.Publish(MakeSnapshot(5)), "same version is not published"sv);
+        Check(publisher.Get()->GetVersion() == 5, "current version is kept"sv);
+
+        const auto newer = MakeSnapshot(6);
+        Check(publisher.Publish(newer), "newer version is published"sv);
+        Check(publisher.Get() == newer, "published snapshot is returned"sv);
+    }
+
+    void TestConcurrentPublish() {
+        const size_t writer_count = 4;
+        const size_t reader_count = 2;
+        const uint64_t version_count = 2000;
+
+        // снимки строятся заранее, чтобы потоки соревновались только за публикацию;
+        // писатель w публикует версии w + 1, w + 1 + writer_count, ... по возрастанию
+        std::vector<std::vector<std::shared_ptr<const transport::Snapshot>>> snapshots(writer_count);
+        for (uint64_t version = 1; version <= version_count; ++version) {
+            snapshots[(version - 1) % writer_count].push_back(MakeSnapshot(version));
+        }
+
+        transport::SnapshotPublisher publisher(MakeSnapshot(0));
+        std::atomic<bool> writing{ true };
+        std::atomic<size_t> published{ 0 };
+        std::atomic<size_t> violations{ 0 };
+
+        std::vector<std::thread> readers;
+        for (size_t i = 0; i < reader_count; ++i) {
+            readers.emplace_back([&] {
+                uint64_t last = 0;
+                while (writing) {
+                    const uint64_t version = publisher.Get()->GetVersion();
+                    if (version < last) {
+                        ++violations;
+                    }
+                    last = version;
+                }
+            });
+        }
+
+        std::vector<std::thread> writers;
+        for (size_t i = 0; i < writer_count; ++i) {
+            writers.emplace_back([&, i] {
+                for (const auto& snapshot : snapshots[i]) {
+                    const uint64_t before = publisher.Get()->GetVersion();
+                    if (publisher.Publish(snapshot)) {
+                        ++published;
+                    }
+                    else if (before >= snapshot->GetVersion()) {
+                        // отказ ожидаем: уже была версия не старее
+                    }
+                    else if (publisher.Get()->GetVersion() < snapshot->GetVersion()) {
+                        ++violations;  // отказ, хотя текущая версия старее
+                    }
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        writing = false;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        Check(violations == 0, "version never goes back and newer snapshots are not rejected"sv);
+        Check(published > 0 && published <= version_count, "publish count is in range"sv);
+        Check(publisher.Get()->GetVersion() == version_count, "the newest version wins"sv);
+    }
+
+}  // namespace
+
+int main() {
+    TestVersionCheck();
+    TestConcurrentPublish();
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "snapshot_publisher_test: OK\n"sv;
+    return EXIT_SUCCESS;
+}
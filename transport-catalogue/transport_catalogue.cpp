@@ -1,79 +1,88 @@
 ﻿#include <algorithm>
 #include <string_view>
+#include <tuple>
 
 #include "transport_catalogue.h"
 
 namespace transport {
 
-    void TransportCatalogue::AddBus(Bus&& bus) {
+    void TransportCatalogue::AddBus(std::string name, const std::vector<const Stop*>& stops, bool is_roundtrip) {
+		Bus bus;
+		bus.name = std::move(name);
+		bus.route_offset = EncodeRoute(route_pool_, stops);
+		bus.stops_count = stops.size();
+		bus.is_roundtrip = is_roundtrip;
+		bus.id = buses_.size();
 		buses_.push_back(std::move(bus));
 		busname_to_bus_[buses_.back().name] = &buses_.back();
-		for (const Stop* stop : buses_.back().route) {
-        	buses_for_stop_[stop->name].emplace(buses_.back().name);
-    	}
+		indexes_outdated_ = true;
 	}
 
     void TransportCatalogue::AddStop(Stop&& stop) {
 		stops_.push_back(std::move(stop));
+		stops_.back().id = stops_.size() - 1;
+		stops_coordinates_.push_back(geo::CacheCoordinates(stops_.back().coordinates));
 		stopname_to_stop_[stops_.back().name] = &stops_.back();
-		buses_for_stop_[stops_.back().name];
+		indexes_outdated_ = true;
 	}
 
     const Bus* TransportCatalogue::FindBus(std::string_view name_bus) const {
-		if (busname_to_bus_.count(name_bus)) {
-			return busname_to_bus_.at(name_bus);
-		}
-		return nullptr;
+		const auto it = busname_to_bus_.find(name_bus);
+		return it != busname_to_bus_.end() ? it->second : nullptr;
 	}
 
     const Stop* TransportCatalogue::FindStop(std::string_view name_stop) const {
-        if (stopname_to_stop_.count(name_stop)) {
-            return stopname_to_stop_.at(name_stop);
-        }
-        return nullptr;
+        const auto it = stopname_to_stop_.find(name_stop);
+        return it != stopname_to_stop_.end() ? it->second : nullptr;
     }
 
-	double TransportCatalogue::ComputeGeoRouteLength(const Bus* bus) {
+	RouteView TransportCatalogue::GetRoute(const Bus& bus) const {
+		return RouteView(route_pool_.data() + bus.route_offset, bus.stops_count, !bus.is_roundtrip, stops_);
+	}
 
-		if (!bus) {
-			return 0;
-		}
+	double TransportCatalogue::ComputeGeoRouteLength(RouteView route) const {
 
-		double route_length = 0;
-		const auto& route = bus->route;
+		// расстояния перегонов считаются пакетами по кэшу координат остановок в буферах на стеке,
+		// сумма накапливается в порядке перегонов
+		constexpr size_t BLOCK_SIZE = 64;
+		size_t stop_ids[BLOCK_SIZE + 1];
+		double distances[BLOCK_SIZE];
+		size_t ids_count = 0;
 
-		for (size_t i = 1; i < route.size(); ++i) {
-			const auto& from_stop = route[i - 1];
-			const auto& to_stop = route[i];
-			
-			double distance = geo::ComputeDistance(from_stop->coordinates, to_stop->coordinates);
-			
-			route_length += distance;
+		double route_length = 0;
+		const auto add_block = [&](size_t count) {
+			geo::ComputeDistances(stops_coordinates_.data(), stop_ids, stop_ids + 1, count, distances);
+			for (size_t i = 0; i < count; ++i) {
+				route_length += distances[i];
+			}
+		};
+
+		for (const Stop* stop : route) {
+			stop_ids[ids_count++] = stop->id;
+			if (ids_count == BLOCK_SIZE + 1) {
+				add_block(BLOCK_SIZE);
+				// последняя остановка пакета - начало первого перегона следующего
+				stop_ids[0] = stop_ids[BLOCK_SIZE];
+				ids_count = 1;
+			}
+		}
+		if (ids_count > 1) {
+			add_block(ids_count - 1);
 		}
 
 		return route_length;
 	}
 
-	size_t TransportCatalogue::ComputeLinearRouteLength(const Bus* bus) const {
-
-		if (!bus) {
-			return 0;
-		}
+	size_t TransportCatalogue::ComputeLinearRouteLength(RouteView route) const {
 
 		size_t route_length = 0;
-		const auto& route = bus->route;
-
-		for (size_t i = 1; i < route.size(); ++i) {
-			const auto& from_stop = route[i - 1];
-			const auto& to_stop = route[i];
-			
-			size_t distance = 0;
+		const Stop* from_stop = nullptr;
 
-			if (GetStopPairDistances(from_stop, to_stop).has_value()) {
-				distance = GetStopPairDistances(from_stop, to_stop).value();
+		for (const Stop* to_stop : route) {
+			if (from_stop) {
+				route_length += GetStopPairDistances(from_stop, to_stop).value_or(0);
 			}
-			
-			route_length += distance;
+			from_stop = to_stop;
 		}
 
 		return route_length;
@@ -101,63 +110,235 @@ namespace transport {
 
 	std::optional<BusInfo> TransportCatalogue::GetBusInfo(std::string_view name_bus) const {
 
-		auto it = busname_to_bus_.find(name_bus);
-
-		if (it != busname_to_bus_.end()) {
-			const Bus& bus = *(it->second);
-			BusInfo bus_info;
-			bus_info.bus_name = bus.name;
-			bus_info.stops = bus.route.size();
-			bus_info.uniq_stops = GetUniqStops(bus.route);
-			bus_info.route_length = static_cast<double>(ComputeLinearRouteLength(&bus));
-			bus_info.curvature = bus_info.route_length / ComputeGeoRouteLength(&bus);
-			return bus_info;
-		} else {
+		const Bus* bus = FindBus(name_bus);
+
+		if (!bus) {
 			return std::nullopt;
 		}
-    }
+		return GetBusInfo(*bus);
+	}
+
+	BusInfo TransportCatalogue::GetBusInfo(const Bus& bus) const {
+
+		const RouteView route = GetRoute(bus);
+		BusInfo bus_info;
+		bus_info.bus_name = bus.name;
+		bus_info.stops = route.size();
+		bus_info.uniq_stops = GetUniqStops(route);
+		bus_info.route_length = static_cast<double>(ComputeLinearRouteLength(route));
+		bus_info.curvature = bus_info.route_length / ComputeGeoRouteLength(route);
+		return bus_info;
+	}
 
 	std::optional<StopInfo> TransportCatalogue::GetBusesForStop(std::string_view stop_name) const {
 
-		auto it = buses_for_stop_.find(stop_name);
+		const Stop* stop = FindStop(stop_name);
 
-		if (it != buses_for_stop_.end()) {
-			StopInfo stop_info;
-			stop_info.buses = it->second;
-			return stop_info;
-		} else {
+		if (!stop) {
 			return std::nullopt;
 		}
+		return GetBusesForStop(*stop);
 	}
 
-	const std::deque<const Stop*> TransportCatalogue::BusesForStop() const {
-		std::deque<const Stop*> stops_with_buses;
-		
-		for (const auto& [stop_name, bus_set] : buses_for_stop_) {
-			if (!bus_set.empty()) {
-				stops_with_buses.push_back(FindStop(stop_name));
-			}
+	StopInfo TransportCatalogue::GetBusesForStop(const Stop& stop) const {
+
+		BuildIndexes();
+		return StopInfo{ 0, BusRange{ stop_buses_pool_.begin() + stop_buses_offsets_[stop.id],
+									  stop_buses_pool_.begin() + stop_buses_offsets_[stop.id + 1] } };
+	}
+
+	std::optional<std::vector<DirectBus>> TransportCatalogue::GetDirectBuses(std::string_view stop_from, std::string_view stop_to) const {
+
+		const Stop* from = FindStop(stop_from);
+		const Stop* to = FindStop(stop_to);
+
+		if (!from || !to) {
+			return std::nullopt;
 		}
-		std::sort(stops_with_buses.begin(), stops_with_buses.end(), [](const domain::Stop* lhs, const domain::Stop* rhs) {
-			return lhs->name < rhs->name;
-			});
-		return stops_with_buses;
+		return GetDirectBuses(*from, *to);
 	}
 
-	const std::map<std::string_view, const Bus*> TransportCatalogue::GetSortedBuses() const {
-		std::map<std::string_view, const Bus*> result;
-		for (const auto& bus : busname_to_bus_) {
-			result.emplace(bus);
+	std::vector<DirectBus> TransportCatalogue::GetDirectBuses(const Stop& from, const Stop& to) const {
+
+		BuildIndexes();
+
+		// списки автобусов обеих остановок отсортированы по имени, пересекаем их слиянием
+		auto from_it = stop_buses_pool_.begin() + stop_buses_offsets_[from.id];
+		const auto from_end = stop_buses_pool_.begin() + stop_buses_offsets_[from.id + 1];
+		auto to_it = stop_buses_pool_.begin() + stop_buses_offsets_[to.id];
+		const auto to_end = stop_buses_pool_.begin() + stop_buses_offsets_[to.id + 1];
+
+		std::vector<DirectBus> result;
+		while (from_it != from_end && to_it != to_end) {
+			const size_t from_rank = bus_name_ranks_[(*from_it)->id];
+			const size_t to_rank = bus_name_ranks_[(*to_it)->id];
+			if (from_rank < to_rank) {
+				++from_it;
+			}
+			else if (to_rank < from_rank) {
+				++to_it;
+			}
+			else {
+				// автобус проходит через обе остановки, но может не возить от from к to
+				if (auto span = ComputeDirectSpan(**from_it, from.id, to.id)) {
+					result.push_back({ *from_it, *span });
+				}
+				++from_it;
+				++to_it;
+			}
 		}
 		return result;
 	}
 
-	const std::map<std::string_view, const Stop*> TransportCatalogue::GetSortedStops() const {
-		std::map<std::string_view, const Stop*> result;
-		for (const auto& stop : stopname_to_stop_) {
-			result.emplace(stop);
+	std::optional<size_t> TransportCatalogue::ComputeDirectSpan(const Bus& bus, size_t stop_from_id, size_t stop_to_id) const {
+
+		const auto positions_begin = bus_positions_pool_.begin() + bus_positions_offsets_[bus.id];
+		const auto positions_end = bus_positions_pool_.begin() + bus_positions_offsets_[bus.id + 1];
+		auto by_stop = [](const StopPosition& lhs, const StopPosition& rhs) {
+			return lhs.stop_id < rhs.stop_id;
+		};
+		const auto [from_begin, from_end] = std::equal_range(positions_begin, positions_end, StopPosition{ stop_from_id, 0 }, by_stop);
+		const auto [to_begin, to_end] = std::equal_range(positions_begin, positions_end, StopPosition{ stop_to_id, 0 }, by_stop);
+
+		// позиции одной остановки отсортированы по возрастанию, для каждой позиции from
+		// ближайшую позицию to впереди (и позади для некольцевого) находим одним проходом
+		std::optional<size_t> span;
+		auto update = [&span](size_t candidate) {
+			if (candidate > 0 && (!span || candidate < *span)) {
+				span = candidate;
+			}
+		};
+
+		auto to_it = to_begin;
+		for (auto from_it = from_begin; from_it != from_end; ++from_it) {
+			while (to_it != to_end && to_it->position <= from_it->position) {
+				++to_it;
+			}
+			if (to_it != to_end) {
+				update(to_it->position - from_it->position);
+			}
+			if (!bus.is_roundtrip && to_it != to_begin) {
+				update(from_it->position - std::prev(to_it)->position);
+			}
+		}
+		return span;
+	}
+
+	void TransportCatalogue::FindNearestStops(geo::Coordinates center, size_t count, std::vector<NearestStop>& result) const {
+		BuildIndexes();
+		stops_index_.FindNearest(center, count, result);
+	}
+
+	void TransportCatalogue::FindStopsWithinRadius(geo::Coordinates center, double radius, std::vector<NearestStop>& result) const {
+		BuildIndexes();
+		stops_index_.FindWithinRadius(center, radius, result);
+	}
+
+	StopRange TransportCatalogue::BusesForStop() const {
+		BuildIndexes();
+		return ranges::AsRange(stops_with_buses_);
+	}
+
+	BusRange TransportCatalogue::GetSortedBuses() const {
+		BuildIndexes();
+		return ranges::AsRange(sorted_buses_);
+	}
+
+	StopRange TransportCatalogue::GetSortedStops() const {
+		BuildIndexes();
+		return ranges::AsRange(sorted_stops_);
+	}
+
+	void TransportCatalogue::BuildIndexes() const {
+
+		if (!indexes_outdated_) {
+			return;
 		}
-		return result;
+
+		sorted_buses_.clear();
+		sorted_buses_.reserve(buses_.size());
+		for (const Bus& bus : buses_) {
+			sorted_buses_.push_back(&bus);
+		}
+		std::sort(sorted_buses_.begin(), sorted_buses_.end(), [](const Bus* lhs, const Bus* rhs) {
+			return lhs->name < rhs->name;
+			});
+		bus_name_ranks_.resize(buses_.size());
+		for (size_t rank = 0; rank < sorted_buses_.size(); ++rank) {
+			bus_name_ranks_[sorted_buses_[rank]->id] = rank;
+		}
+
+		sorted_stops_.clear();
+		sorted_stops_.reserve(stops_.size());
+		for (const Stop& stop : stops_) {
+			sorted_stops_.push_back(&stop);
+		}
+		std::sort(sorted_stops_.begin(), sorted_stops_.end(), [](const Stop* lhs, const Stop* rhs) {
+			return lhs->name < rhs->name;
+			});
+
+		// автобусы обходим в порядке имен, тогда список каждой остановки получается уже отсортированным.
+		// Остановка может встречаться в маршруте несколько раз, поэтому запоминаем,
+		// для какого автобуса она уже учтена
+		const size_t no_bus = sorted_buses_.size();
+		std::vector<size_t> last_bus(stops_.size(), no_bus);
+
+		// считаем размеры списков и переводим их в смещения в общем пуле
+		stop_buses_offsets_.assign(stops_.size() + 1, 0);
+		for (size_t i = 0; i < sorted_buses_.size(); ++i) {
+			for (const Stop* stop : GetRoute(*sorted_buses_[i]).Declared()) {
+				if (last_bus[stop->id] != i) {
+					last_bus[stop->id] = i;
+					++stop_buses_offsets_[stop->id + 1];
+				}
+			}
+		}
+		for (size_t i = 1; i < stop_buses_offsets_.size(); ++i) {
+			stop_buses_offsets_[i] += stop_buses_offsets_[i - 1];
+		}
+
+		stop_buses_pool_.resize(stop_buses_offsets_.back());
+		std::vector<size_t> fill_positions(stop_buses_offsets_.begin(), stop_buses_offsets_.end() - 1);
+		last_bus.assign(stops_.size(), no_bus);
+		for (size_t i = 0; i < sorted_buses_.size(); ++i) {
+			for (const Stop* stop : GetRoute(*sorted_buses_[i]).Declared()) {
+				if (last_bus[stop->id] != i) {
+					last_bus[stop->id] = i;
+					stop_buses_pool_[fill_positions[stop->id]++] = sorted_buses_[i];
+				}
+			}
+		}
+
+		// таблицы позиций остановок для каждого автобуса
+		bus_positions_offsets_.assign(buses_.size() + 1, 0);
+		bus_positions_pool_.clear();
+		for (const Bus& bus : buses_) {
+			size_t position = 0;
+			for (const Stop* stop : GetRoute(bus).Declared()) {
+				bus_positions_pool_.push_back({ stop->id, position++ });
+			}
+			bus_positions_offsets_[bus.id + 1] = bus_positions_pool_.size();
+			std::sort(bus_positions_pool_.begin() + bus_positions_offsets_[bus.id], bus_positions_pool_.end(),
+				[](const StopPosition& lhs, const StopPosition& rhs) {
+					return std::tie(lhs.stop_id, lhs.position) < std::tie(rhs.stop_id, rhs.position);
+				});
+		}
+
+		std::vector<std::pair<geo::Coordinates, const Stop*>> stop_points;
+		stop_points.reserve(stops_.size());
+		for (const Stop& stop : stops_) {
+			stop_points.emplace_back(stop.coordinates, &stop);
+		}
+		stops_index_ = geo::SpatialIndex<const Stop*>(stop_points);
+
+		stops_with_buses_.clear();
+		for (const Stop* stop : sorted_stops_) {
+			if (stop_buses_offsets_[stop->id] != stop_buses_offsets_[stop->id + 1]) {
+				stops_with_buses_.push_back(stop);
+			}
+		}
+
+		indexes_outdated_ = false;
 	}
 
 } // namespace transport 
\ No newline at end of file
@@ -3,19 +3,23 @@
 #include <deque>
 #include <optional>
 #include <unordered_map>
-#include <map>
+#include <vector>
 
 #include "geo.h"
 #include "domain.h"
+#include "spatial_index.h"
 
 using namespace domain;
 
 namespace transport {
+
+	using NearestStop = geo::SpatialIndex<const Stop*>::Neighbor;
 	
 	class TransportCatalogue {
 
 	public:
-		void AddBus(Bus&& bus);
+		// маршрут задается в объявленном направлении, для некольцевого обратный путь не дублируется
+		void AddBus(std::string name, const std::vector<const Stop*>& stops, bool is_roundtrip);
 
 		void AddStop(Stop&& stop);
 
@@ -23,38 +27,87 @@ namespace transport {
 
 		[[nodiscard]] std::optional<size_t> GetStopPairDistances(const Stop* from, const Stop* to) const;
 
+		inline const std::unordered_map<std::pair<const Stop*, const Stop*>, size_t, StopPairHasher>& GetAllStopPairDistances() const {
+			return stop_pair_distances_;
+		}
+
 		[[nodiscard]] const Bus* FindBus(std::string_view name_bus) const;
 
 		[[nodiscard]] const Stop* FindStop(std::string_view name_stop) const;
 
+		// полный обход маршрута (для некольцевого - туда и обратно)
+		[[nodiscard]] RouteView GetRoute(const Bus& bus) const;
+
 		[[nodiscard]] std::optional<BusInfo> GetBusInfo(std::string_view name_bus) const;
+		[[nodiscard]] BusInfo GetBusInfo(const Bus& bus) const;
 
 		[[nodiscard]] std::optional<StopInfo> GetBusesForStop(std::string_view stop_name) const;
+		[[nodiscard]] StopInfo GetBusesForStop(const Stop& stop) const;
+
+		// автобусы (в порядке имен), которые довозят от stop_from до stop_to без пересадки;
+		// nullopt, если одной из остановок нет в каталоге
+		[[nodiscard]] std::optional<std::vector<DirectBus>> GetDirectBuses(std::string_view stop_from, std::string_view stop_to) const;
+		[[nodiscard]] std::vector<DirectBus> GetDirectBuses(const Stop& from, const Stop& to) const;
+
+		// остановки, через которые проходит хотя бы один автобус, в порядке имен
+		StopRange BusesForStop() const;
 
-		const std::deque<const domain::Stop*> BusesForStop() const;
+		// count ближайших к точке остановок по возрастанию расстояния; result переиспользуется между вызовами
+		void FindNearestStops(geo::Coordinates center, size_t count, std::vector<NearestStop>& result) const;
+
+		// все остановки не дальше radius метров от точки (включая остановку в самой точке)
+		void FindStopsWithinRadius(geo::Coordinates center, double radius, std::vector<NearestStop>& result) const;
 
 		inline const std::deque<domain::Bus>& GetBuses() const { return buses_; }
 
 		inline const std::deque<domain::Stop>& GetStops() const { return stops_; }
 
-		const std::map<std::string_view, const Bus*> GetSortedBuses() const;
+		BusRange GetSortedBuses() const;
+
+		StopRange GetSortedStops() const;
 
-		const std::map<std::string_view, const Stop*> GetSortedStops() const;
+		// Строит индексы для чтения (сортировки по имени, автобусы по остановкам).
+		// Вызывается лениво из запросов, после изменения каталога индексы перестраиваются заново
+		void BuildIndexes() const;
 
 	private:
 		std::deque<Stop> stops_;
 		std::unordered_map<std::string_view, const Stop*> stopname_to_stop_;  // остановки с именами
+		std::vector<geo::CachedCoordinates> stops_coordinates_;  // координаты остановок по id с тригонометрией широты
 
 		std::deque<Bus> buses_;
 		std::unordered_map<std::string_view, const Bus*> busname_to_bus_;  // автобусы с именами
-
-		std::unordered_map<std::string_view, std::set<std::string_view>> buses_for_stop_;  // список автобусов на остановке
+		std::vector<uint8_t> route_pool_;  // закодированные маршруты всех автобусов
+
+		// список автобусов на остановке: для остановки с id автобусы лежат в общем пуле
+		// в диапазоне [stop_buses_offsets_[id], stop_buses_offsets_[id + 1]), отсортированные по имени
+		mutable std::vector<size_t> stop_buses_offsets_;
+		mutable std::vector<const Bus*> stop_buses_pool_;
+		mutable std::vector<const Bus*> sorted_buses_;  // автобусы в порядке имен
+		mutable std::vector<const Stop*> sorted_stops_;  // остановки в порядке имен
+		mutable std::vector<const Stop*> stops_with_buses_;  // остановки с автобусами в порядке имен
+		mutable std::vector<size_t> bus_name_ranks_;  // место автобуса с данным id в порядке имен
+
+		// позиции остановок в объявленном направлении маршрута: для автобуса с id пары (id остановки, позиция)
+		// лежат в диапазоне [bus_positions_offsets_[id], bus_positions_offsets_[id + 1]), отсортированные по id
+		struct StopPosition {
+			size_t stop_id;
+			size_t position;
+		};
+		mutable std::vector<size_t> bus_positions_offsets_;
+		mutable std::vector<StopPosition> bus_positions_pool_;
+
+		mutable geo::SpatialIndex<const Stop*> stops_index_;  // остановки по координатам
+
+		mutable bool indexes_outdated_ = true;
 
 		std::unordered_map<std::pair<const Stop*, const Stop*>, size_t, StopPairHasher> stop_pair_distances_;  // список расстояний между парой остановок
 
-		static double ComputeGeoRouteLength(const Bus* bus);
+		double ComputeGeoRouteLength(RouteView route) const;
+
+		size_t ComputeLinearRouteLength(RouteView route) const;
 
-		size_t ComputeLinearRouteLength(const Bus* bus) const;
+		std::optional<size_t> ComputeDirectSpan(const Bus& bus, size_t stop_from_id, size_t stop_to_id) const;
 	};
 
 } // namespace transport
\ No newline at end of file
@@ -1,5 +1,7 @@
 ﻿#include "transport_router.h"
 
+#include <unordered_map>
+
 
 namespace transport {
 
@@ -11,96 +13,455 @@ namespace transport {
         return METERS_IN_KM / MINUTES_IN_HOUR;
     }
 
-    void Router::StopsToGraph(const std::map<std::string_view, const Stop*>& sort_stops, 
+    Router::Router(const RouterSettings& settings,
+                   graph::DirectedWeightedGraph<double> graph,
+                   graph::Router<double>::RoutesInternalData routes_internal_data,
+                   const TransportCatalogue& catalogue)
+        : settings_(settings)
+        , graph_(std::move(graph))
+    {
+        // вершины ожидания идут парами в порядке имен остановок, как в StopsToGraph
+        graph::VertexId vertex_id = 0;
+        for (const Stop* stop_info : catalogue.GetSortedStops()) {
+            stop_ids_[stop_info->name] = vertex_id;
+            vertex_id += 2;
+        }
+        if (vertex_id != graph_.GetVertexCount()) {
+            throw std::invalid_argument("Graph doesn't match the catalogue");
+        }
+
+        router_ = std::make_unique<graph::Router<double>>(graph_, routes_internal_data);
+    }
+
+    // компоненты связности графа без учета направления ребер
+    struct Components {
+        std::vector<size_t> vertex_component;  // номер компоненты вершины
+        std::vector<size_t> edge_position;  // место ребра в списке ребер компоненты его начала
+        std::vector<std::vector<graph::VertexId>> vertices;  // вершины компонент по возрастанию
+        std::vector<std::vector<graph::EdgeId>> edges;  // ребра компонент по возрастанию
+        std::vector<std::string_view> vertex_stops;  // имена остановок вершин
+    };
+
+    static Components FindComponents(const graph::DirectedWeightedGraph<double>& graph,
+                                     const std::map<std::string, graph::VertexId>& stop_ids) {
+        const size_t vertex_count = graph.GetVertexCount();
+
+        // система непересекающихся множеств по ребрам графа
+        std::vector<graph::VertexId> parent(vertex_count);
+        for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            parent[vertex] = vertex;
+        }
+        const auto find_root = [&parent](graph::VertexId vertex) {
+            while (parent[vertex] != vertex) {
+                vertex = parent[vertex] = parent[parent[vertex]];
+            }
+            return vertex;
+        };
+        for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            parent[find_root(edge.from)] = find_root(edge.to);
+        }
+
+        // компоненты нумеруются в порядке их первых вершин
+        Components components;
+        components.vertex_component.resize(vertex_count);
+        std::vector<size_t> root_component(vertex_count, vertex_count);
+        for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            size_t& component = root_component[find_root(vertex)];
+            if (component == vertex_count) {
+                component = components.vertices.size();
+                components.vertices.emplace_back();
+                components.edges.emplace_back();
+            }
+            components.vertex_component[vertex] = component;
+            components.vertices[component].push_back(vertex);
+        }
+
+        components.edge_position.resize(graph.GetEdgeCount());
+        for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            auto& edges = components.edges[components.vertex_component[graph.GetEdge(edge_id).from]];
+            components.edge_position[edge_id] = edges.size();
+            edges.push_back(edge_id);
+        }
+
+        // у остановки две вершины подряд: ожидание и посадка
+        components.vertex_stops.resize(vertex_count);
+        for (const auto& [name, vertex_id] : stop_ids) {
+            components.vertex_stops[vertex_id] = components.vertex_stops[vertex_id + 1] = name;
+        }
+        return components;
+    }
+
+    // Компонента прежнего графа, совпадающая с компонентой нового вплоть до нумерации: те же остановки
+    // и те же ребра в том же порядке. Маршруты внутри нее не меняются, их можно перенести
+    static std::optional<size_t> MatchComponent(const graph::DirectedWeightedGraph<double>& graph,
+                                                const Components& components, size_t component,
+                                                const graph::DirectedWeightedGraph<double>& previous_graph,
+                                                const Components& previous_components,
+                                                const std::map<std::string, graph::VertexId>& previous_stop_ids) {
+        const auto& vertices = components.vertices[component];
+        const auto& edges = components.edges[component];
+
+        const auto previous_first = previous_stop_ids.find(std::string(components.vertex_stops[vertices.front()]));
+        if (previous_first == previous_stop_ids.end()) {
+            return std::nullopt;
+        }
+        // первая вершина компоненты всегда вершина ожидания с четным номером
+        const size_t previous_component = previous_components.vertex_component[previous_first->second];
+        const auto& previous_vertices = previous_components.vertices[previous_component];
+        const auto& previous_edges = previous_components.edges[previous_component];
+        if (previous_vertices.size() != vertices.size() || previous_edges.size() != edges.size()) {
+            return std::nullopt;
+        }
+
+        // место вершины в ее компоненте; вершины сопоставляются по местам
+        std::unordered_map<graph::VertexId, size_t> previous_positions;
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            if (vertices[i] % 2 != previous_vertices[i] % 2
+                || components.vertex_stops[vertices[i]] != previous_components.vertex_stops[previous_vertices[i]]) {
+                return std::nullopt;
+            }
+            previous_positions[previous_vertices[i]] = i;
+        }
+
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const auto& edge = graph.GetEdge(edges[i]);
+            const auto& previous_edge = previous_graph.GetEdge(previous_edges[i]);
+            if (edge.name != previous_edge.name
+                || edge.quality != previous_edge.quality
+                || edge.type != previous_edge.type
+                || edge.weight != previous_edge.weight
+                || vertices[previous_positions.at(previous_edge.from)] != edge.from
+                || vertices[previous_positions.at(previous_edge.to)] != edge.to) {
+                return std::nullopt;
+            }
+        }
+        return previous_component;
+    }
+
+    void Router::StopsToGraph(StopRange sort_stops, 
                               graph::DirectedWeightedGraph<double>& stops_graph, 
                               std::map<std::string, graph::VertexId>& stop_ids) {
 
         graph::VertexId vertex_id = 0;
 
-        for (const auto& [stop_name, stop_info] : sort_stops) {
+        for (const Stop* stop_info : sort_stops) {
             stop_ids[stop_info->name] = vertex_id;
             stops_graph.AddEdge({ stop_info->name,
                                   0,
                                   vertex_id,
                                   ++vertex_id,
-                                  static_cast<double>(settings_.bus_wait_time_)
+                                  static_cast<double>(settings_.bus_wait_time_),
+                                  graph::EdgeType::WAIT
                 });
             ++vertex_id;
         }
         stop_ids_ = std::move(stop_ids);
     }
 
-    void Router::BusesToGraph(const std::map<std::string_view, const Bus*>& sort_buses,
+    void Router::BusesToGraph(BusRange sort_buses,
                               graph::DirectedWeightedGraph<double>& stops_graph,
-                              const TransportCatalogue& catalogue) {
+                              const TransportCatalogue& catalogue,
+                              std::vector<graph::Ride>* rides) {
 
         std::for_each(sort_buses.begin(), sort_buses.end(),
-            [&stops_graph, this, &catalogue](const auto& buses_for_stops) {
+            [&stops_graph, this, &catalogue, rides](const Bus* bus_info) {
 
-                const auto& bus_info = buses_for_stops.second;
-                const auto& stops = bus_info->route;
+                // маршрут обходится только в объявленном направлении, обратные ребра некольцевого
+                // маршрута строятся по тем же парам остановок
+                const RouteView route = catalogue.GetRoute(*bus_info).Declared();
+                const std::vector<const Stop*> stops(route.begin(), route.end());
                 size_t stops_count = stops.size();
 
+                // поездки туда и, у некольцевого маршрута, обратно; обратная проходит остановки с конца
+                graph::Ride forward;
+                graph::Ride backward;
+                if (rides) {
+                    for (size_t i = 0; i < stops_count; ++i) {
+                        forward.from_vertices.push_back(stop_ids_.at(stops[i]->name) + 1);
+                        forward.to_vertices.push_back(stop_ids_.at(stops[i]->name));
+                    }
+                    forward.edges.resize(stops_count * (stops_count - 1) / 2);
+                    backward.from_vertices.assign(forward.from_vertices.rbegin(), forward.from_vertices.rend());
+                    backward.to_vertices.assign(forward.to_vertices.rbegin(), forward.to_vertices.rend());
+                    backward.edges.resize(forward.edges.size());
+                }
+                // номер ребра от i-й до j-й остановки поездки в ее списке ребер
+                const auto ride_edge = [stops_count](size_t i, size_t j) {
+                    return i * (2 * stops_count - i - 1) / 2 + (j - i - 1);
+                };
+
                 for (size_t i = 0; i < stops_count; ++i) {
+                    int dist_sum = 0;
+                    int dist_sum_inverse = 0;
+
                     for (size_t j = i + 1; j < stops_count; ++j) {
                         const Stop* stop_from = stops[i];
                         const Stop* stop_to = stops[j];
-                        int dist_sum = 0;
-                        int dist_sum_inverse = 0;
-
-                        for (size_t k = i + 1; k <= j; ++k) {
-                            auto sum1 = catalogue.GetStopPairDistances(stops[k - 1], stops[k]);
-                            auto sum2 = catalogue.GetStopPairDistances(stops[k], stops[k - 1]);
-                            if (sum1 && sum2) {
-                                dist_sum += sum1.value();
-                                dist_sum_inverse += sum2.value();
-                            }
+
+                        auto sum1 = catalogue.GetStopPairDistances(stops[j - 1], stops[j]);
+                        auto sum2 = catalogue.GetStopPairDistances(stops[j], stops[j - 1]);
+                        if (sum1 && sum2) {
+                            dist_sum += sum1.value();
+                            dist_sum_inverse += sum2.value();
                         }
 
-                        stops_graph.AddEdge({ bus_info->name,
-                                              j - i,
-                                              stop_ids_.at(stop_from->name) + 1,
-                                              stop_ids_.at(stop_to->name),
-                                              static_cast<double>(dist_sum) / (settings_.bus_velocity_ * ConvertSpeed()) });
+                        const graph::EdgeId edge_id = stops_graph.AddEdge({ bus_info->name,
+                                                                            j - i,
+                                                                            stop_ids_.at(stop_from->name) + 1,
+                                                                            stop_ids_.at(stop_to->name),
+                                                                            static_cast<double>(dist_sum) / (settings_.bus_velocity_ * ConvertSpeed()) });
+                        if (rides) {
+                            forward.edges[ride_edge(i, j)] = edge_id;
+                        }
 
                         if (!bus_info->is_roundtrip) {
-                            stops_graph.AddEdge({ bus_info->name,
-                                                  j - i,
-                                                  stop_ids_.at(stop_to->name) + 1,
-                                                  stop_ids_.at(stop_from->name),
-                                                  static_cast<double>(dist_sum_inverse) / (settings_.bus_velocity_ * ConvertSpeed()) });
+                            const graph::EdgeId inverse_edge_id = stops_graph.AddEdge({ bus_info->name,
+                                                                                        j - i,
+                                                                                        stop_ids_.at(stop_to->name) + 1,
+                                                                                        stop_ids_.at(stop_from->name),
+                                                                                        static_cast<double>(dist_sum_inverse) / (settings_.bus_velocity_ * ConvertSpeed()) });
+                            if (rides) {
+                                backward.edges[ride_edge(stops_count - 1 - j, stops_count - 1 - i)] = inverse_edge_id;
+                            }
                         }
                     }
                 }
+
+                if (rides) {
+                    rides->push_back(std::move(forward));
+                    if (!bus_info->is_roundtrip) {
+                        rides->push_back(std::move(backward));
+                    }
+                }
             });
+    }
 
-        graph_ = std::move(stops_graph);
-        router_ = std::make_unique<graph::Router<double>>(graph_);
+    void Router::WalksToGraph(StopRange sort_stops,
+                              graph::DirectedWeightedGraph<double>& stops_graph,
+                              const TransportCatalogue& catalogue) {
+
+        // пары соседних остановок берем из пространственного индекса каталога, а не перебором всех пар
+        std::vector<NearestStop> neighbors;
+        for (const Stop* stop_from : sort_stops) {
+            catalogue.FindStopsWithinRadius(stop_from->coordinates, settings_.walking_radius_, neighbors);
+
+            // порядок ребер не должен зависеть от устройства индекса
+            std::sort(neighbors.begin(), neighbors.end(), [](const NearestStop& lhs, const NearestStop& rhs) {
+                return lhs.item->name < rhs.item->name;
+                });
+
+            for (const auto& [stop_to, distance] : neighbors) {
+                if (stop_to == stop_from) {
+                    continue;
+                }
+                // переход ведет к вершине ожидания: дальше пассажир садится в автобус или заканчивает маршрут
+                stops_graph.AddEdge({ stop_to->name,
+                                      0,
+                                      stop_ids_.at(stop_from->name),
+                                      stop_ids_.at(stop_to->name),
+                                      distance / (settings_.walking_velocity_ * ConvertSpeed()),
+                                      graph::EdgeType::WALK });
+            }
+        }
     }
 
-    void Router::BuildGraph(const TransportCatalogue& catalogue) {
+    void Router::BuildGraph(const TransportCatalogue& catalogue, std::vector<graph::Ride>* rides) {
 
         // сортированные списки маршрутов и остановок
-        const auto& sort_stops = catalogue.GetSortedStops();
-        const auto& sort_buses = catalogue.GetSortedBuses();
+        const auto sort_stops = catalogue.GetSortedStops();
+        const auto sort_buses = catalogue.GetSortedBuses();
 
-        graph::DirectedWeightedGraph<double> stops_graph(sort_stops.size() * 2);
+        graph::DirectedWeightedGraph<double> stops_graph(catalogue.GetStops().size() * 2);
         std::map<std::string, graph::VertexId> stop_ids;
         
         // формируем ребра ожиданий для каждой остновки
         Router::StopsToGraph(sort_stops, stops_graph, stop_ids);
 
         // формируем ребра маршрута
-        Router::BusesToGraph(sort_buses, stops_graph, catalogue);
+        Router::BusesToGraph(sort_buses, stops_graph, catalogue, rides);
+
+        // пешие переходы между близкими остановками, если они включены
+        if (settings_.walking_radius_ > 0 && settings_.walking_velocity_ > 0) {
+            Router::WalksToGraph(sort_stops, stops_graph, catalogue);
+        }
+
+        graph_ = std::move(stops_graph);
+    }
+
+    Router::Router(const Router& previous, const TransportCatalogue& catalogue)
+        : settings_(previous.settings_)
+    {
+        if (!previous.router_) {
+            throw std::logic_error("Routes are sharded");
+        }
+        BuildGraph(catalogue);
+
+        using RouteInternalData = graph::Router<double>::RouteInternalData;
+        const Components components = FindComponents(graph_, stop_ids_);
+        const Components previous_components = FindComponents(previous.graph_, previous.stop_ids_);
+
+        const size_t vertex_count = graph_.GetVertexCount();
+        const size_t previous_vertex_count = previous.graph_.GetVertexCount();
+        const auto previous_routes = previous.router_->GetRoutesInternalData().begin();
+
+        std::vector<RouteInternalData> routes(vertex_count * vertex_count, { 0.0, graph::Router<double>::NO_ROUTE });
+        std::vector<std::vector<graph::VertexId>> recompute;
+
+        for (size_t component = 0; component < components.vertices.size(); ++component) {
+            const auto previous_component = MatchComponent(graph_, components, component,
+                                                           previous.graph_, previous_components, previous.stop_ids_);
+            if (!previous_component) {
+                recompute.push_back(components.vertices[component]);
+                continue;
+            }
+
+            const auto& vertices = components.vertices[component];
+            const auto& edges = components.edges[component];
+            const auto& previous_vertices = previous_components.vertices[*previous_component];
+            for (size_t i = 0; i < vertices.size(); ++i) {
+                for (size_t j = 0; j < vertices.size(); ++j) {
+                    RouteInternalData route = previous_routes[previous_vertices[i] * previous_vertex_count + previous_vertices[j]];
+                    if (route.prev_edge < graph::Router<double>::NO_EDGE) {
+                        route.prev_edge = edges[previous_components.edge_position[route.prev_edge]];
+                    }
+                    routes[vertices[i] * vertex_count + vertices[j]] = route;
+                }
+            }
+        }
+
+        router_ = std::make_unique<graph::Router<double>>(graph_, std::move(routes), recompute);
+    }
+
+    static void PartitionStopsRange(std::vector<const Stop*>::iterator begin, std::vector<const Stop*>::iterator end,
+                                    size_t first_shard, size_t shard_count, std::vector<size_t>& stop_shards) {
+        if (shard_count == 1 || begin == end) {
+            for (auto it = begin; it != end; ++it) {
+                stop_shards[(*it)->id] = first_shard;
+            }
+            return;
+        }
+
+        const auto [min_lat, max_lat] = std::minmax_element(begin, end, [](const Stop* lhs, const Stop* rhs) {
+            return lhs->coordinates.lat < rhs->coordinates.lat;
+            });
+        const auto [min_lng, max_lng] = std::minmax_element(begin, end, [](const Stop* lhs, const Stop* rhs) {
+            return lhs->coordinates.lng < rhs->coordinates.lng;
+            });
+        const bool by_lat = (*max_lat)->coordinates.lat - (*min_lat)->coordinates.lat
+                          > (*max_lng)->coordinates.lng - (*min_lng)->coordinates.lng;
+
+        // остановки с одинаковой координатой упорядочены по id, чтобы разбиение было однозначным
+        const size_t left_shards = shard_count / 2;
+        const auto middle = begin + (end - begin) * left_shards / shard_count;
+        std::nth_element(begin, middle, end, [by_lat](const Stop* lhs, const Stop* rhs) {
+            const double lhs_coord = by_lat ? lhs->coordinates.lat : lhs->coordinates.lng;
+            const double rhs_coord = by_lat ? rhs->coordinates.lat : rhs->coordinates.lng;
+            return lhs_coord < rhs_coord || (lhs_coord == rhs_coord && lhs->id < rhs->id);
+            });
+
+        PartitionStopsRange(begin, middle, first_shard, left_shards, stop_shards);
+        PartitionStopsRange(middle, end, first_shard + left_shards, shard_count - left_shards, stop_shards);
+    }
+
+    std::vector<size_t> PartitionStops(const TransportCatalogue& catalogue, size_t shard_count) {
+        if (shard_count == 0) {
+            throw std::invalid_argument("Shard count should be positive");
+        }
+
+        std::vector<const Stop*> stops;
+        stops.reserve(catalogue.GetStops().size());
+        for (const Stop& stop : catalogue.GetStops()) {
+            stops.push_back(&stop);
+        }
+
+        std::vector<size_t> stop_shards(stops.size(), 0);
+        PartitionStopsRange(stops.begin(), stops.end(), 0, shard_count, stop_shards);
+        return stop_shards;
+    }
+
+    std::vector<size_t> Router::VertexShards(const TransportCatalogue& catalogue, const std::vector<size_t>& stop_shards) const {
+        if (stop_shards.size() != catalogue.GetStops().size()) {
+            throw std::invalid_argument("Shards don't match the catalogue");
+        }
+
+        std::vector<size_t> vertex_shards(graph_.GetVertexCount());
+        for (const auto& [name, vertex_id] : stop_ids_) {
+            vertex_shards[vertex_id] = vertex_shards[vertex_id + 1] = stop_shards[catalogue.FindStop(name)->id];
+        }
+        return vertex_shards;
+    }
+
+    Router::Router(const RouterSettings& settings,
+                   const TransportCatalogue& catalogue,
+                   const std::vector<size_t>& stop_shards,
+                   const std::vector<graph::Router<double>::RoutesInternalData>& shard_routes,
+                   std::vector<graph::ShardedRouter<double>::OverlayEdge> overlay_edges,
+                   graph::Router<double>::RoutesInternalData overlay_routes)
+        : settings_(settings)
+    {
+        std::vector<graph::Ride> rides;
+        BuildGraph(catalogue, &rides);
+        sharded_router_ = std::make_unique<graph::ShardedRouter<double>>(graph_, VertexShards(catalogue, stop_shards), std::move(rides),
+                                                                         shard_routes, std::move(overlay_edges), overlay_routes);
+    }
+
+    std::vector<graph::Router<double>::RouteInternalData> Router::BuildShardRoutes(const RouterSettings& settings,
+                                                                                   const TransportCatalogue& catalogue,
+                                                                                   const std::vector<size_t>& stop_shards,
+                                                                                   size_t shard) {
+        // нужен только граф: полная таблица маршрутов не строится
+        Router router;
+        router.settings_ = settings;
+        std::vector<graph::Ride> rides;
+        router.BuildGraph(catalogue, &rides);
+        return graph::ShardedRouter<double>::BuildShardRoutes(router.graph_, router.VertexShards(catalogue, stop_shards), rides, shard);
+    }
+
+    graph::ShardedRouter<double>::Overlay Router::BuildShardOverlay(const RouterSettings& settings,
+                                                                    const TransportCatalogue& catalogue,
+                                                                    const std::vector<size_t>& stop_shards) {
+        Router router;
+        router.settings_ = settings;
+        std::vector<graph::Ride> rides;
+        router.BuildGraph(catalogue, &rides);
+        const size_t shard_count = stop_shards.empty() ? 0 : *std::max_element(stop_shards.begin(), stop_shards.end()) + 1;
+        return graph::ShardedRouter<double>::BuildOverlay(router.graph_, router.VertexShards(catalogue, stop_shards), rides, shard_count);
     }
 
     const std::optional<graph::Router<double>::RouteInfo> Router::FindRoute(const std::string_view stop_from, const std::string_view stop_to) const {
-        return router_->BuildRoute(stop_ids_.at(std::string(stop_from)), stop_ids_.at(std::string(stop_to)));
+        return FindRoute(stop_ids_.at(std::string(stop_from)), stop_ids_.at(std::string(stop_to)));
+    }
+
+    const std::optional<graph::Router<double>::RouteInfo> Router::FindRoute(graph::VertexId from, graph::VertexId to) const {
+        if (sharded_router_) {
+            return sharded_router_->BuildRoute(from, to);
+        }
+        return router_->BuildRoute(from, to);
+    }
+
+    std::optional<graph::VertexId> Router::FindStopVertex(std::string_view stop) const {
+        const auto it = stop_ids_.find(std::string(stop));
+        if (it == stop_ids_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
     }
 
     const graph::DirectedWeightedGraph<double>& Router::GetGraph() const {
         return graph_;
     }
 
+    const RouterSettings& Router::GetSettings() const {
+        return settings_;
+    }
+
+    graph::Router<double>::RoutesInternalData Router::GetRoutesInternalData() const {
+        if (!router_) {
+            throw std::logic_error("Routes are sharded");
+        }
+        return router_->GetRoutesInternalData();
+    }
+
 
 }  // namespace transport
\ No newline at end of file
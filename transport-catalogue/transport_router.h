@@ -2,17 +2,29 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 
 #include "transport_catalogue.h"
 #include "router.h"
+#include "sharded_router.h"
 
 namespace transport {
 
 	struct RouterSettings {
 		int bus_wait_time_ = 0;
 		double bus_velocity_ = 0.0;
+
+		// пешие переходы между остановками не дальше walking_radius_ метров;
+		// при нулевом радиусе или скорости переходы не строятся
+		double walking_radius_ = 0.0;
+		double walking_velocity_ = 0.0;
 	};
 
+	// Разбивает остановки на shard_count географических шардов примерно равного размера:
+	// область рекурсивно делится по широте или долготе (по большему разбросу координат).
+	// Результат - номер шарда остановки по ее id
+	std::vector<size_t> PartitionStops(const TransportCatalogue& catalogue, size_t shard_count);
+
 	class Router {
 	public:
 		Router() = default;
@@ -21,20 +33,71 @@ namespace transport {
 			: settings_(settings)
 		{
 			BuildGraph(catalogue);
+			router_ = std::make_unique<graph::Router<double>>(graph_);
 		}
+
+		// Маршрутизатор для измененного каталога: граф строится заново, а таблица маршрутов
+		// пересчитывается только для компонент связности графа, которых не было в previous.
+		// Совпадающие компоненты переносятся из previous с перенумерацией вершин и ребер
+		Router(const Router& previous, const TransportCatalogue& catalogue);
+
+		// граф и маршруты, построенные ранее для этого каталога (например, загруженные из файла базы)
+		Router(const RouterSettings& settings,
+			   graph::DirectedWeightedGraph<double> graph,
+			   graph::Router<double>::RoutesInternalData routes_internal_data,
+			   const TransportCatalogue& catalogue);
+
+		// Маршруты по шардам (см. graph::ShardedRouter): stop_shards - шард остановки по id,
+		// shard_routes - таблицы шардов, построенные BuildShardRoutes, overlay_edges и overlay_routes -
+		// оверлей, построенный BuildShardOverlay, для того же каталога и настроек
+		Router(const RouterSettings& settings,
+			   const TransportCatalogue& catalogue,
+			   const std::vector<size_t>& stop_shards,
+			   const std::vector<graph::Router<double>::RoutesInternalData>& shard_routes,
+			   std::vector<graph::ShardedRouter<double>::OverlayEdge> overlay_edges,
+			   graph::Router<double>::RoutesInternalData overlay_routes);
+
+		// таблица маршрутов одного шарда, строится независимо от остальных шардов
+		static std::vector<graph::Router<double>::RouteInternalData> BuildShardRoutes(const RouterSettings& settings,
+																					  const TransportCatalogue& catalogue,
+																					  const std::vector<size_t>& stop_shards,
+																					  size_t shard);
+
+		// оверлей, связывающий шарды; таблицы шардов для него не нужны
+		static graph::ShardedRouter<double>::Overlay BuildShardOverlay(const RouterSettings& settings,
+																	   const TransportCatalogue& catalogue,
+																	   const std::vector<size_t>& stop_shards);
 				
 		const std::optional<graph::Router<double>::RouteInfo> FindRoute(const std::string_view stop_from, const std::string_view stop_to) const;
+		const std::optional<graph::Router<double>::RouteInfo> FindRoute(graph::VertexId from, graph::VertexId to) const;
+
+		// вершина графа, из которой начинается маршрут от остановки; nullopt, если остановки нет в графе
+		std::optional<graph::VertexId> FindStopVertex(std::string_view stop) const;
 
 		const graph::DirectedWeightedGraph<double>& GetGraph() const;  // оставил метод в public, т.к. нужен для RequestHandler и удобного вызова
+
+		const RouterSettings& GetSettings() const;
+
+		// полная таблица маршрутов; у маршрутизатора по шардам ее нет
+		graph::Router<double>::RoutesInternalData GetRoutesInternalData() const;
 		
 	private:
-		void BuildGraph(const TransportCatalogue& catalogue);
+		// rides - куда сложить поездки автобусов, если они нужны (для маршрутов по шардам)
+		void BuildGraph(const TransportCatalogue& catalogue, std::vector<graph::Ride>* rides = nullptr);
 
-		void StopsToGraph(const std::map<std::string_view, const Stop*>& sort_stops,
+		// шард каждой вершины графа по шардам остановок
+		std::vector<size_t> VertexShards(const TransportCatalogue& catalogue, const std::vector<size_t>& stop_shards) const;
+
+		void StopsToGraph(StopRange sort_stops,
 						  graph::DirectedWeightedGraph<double>& stops_graph,
 						  std::map<std::string, graph::VertexId>& stop_ids);
 
-		void BusesToGraph(const std::map<std::string_view, const Bus*>& sort_buses,
+		void BusesToGraph(BusRange sort_buses,
+						  graph::DirectedWeightedGraph<double>& stops_graph,
+						  const TransportCatalogue& catalogue,
+						  std::vector<graph::Ride>* rides);
+
+		void WalksToGraph(StopRange sort_stops,
 						  graph::DirectedWeightedGraph<double>& stops_graph,
 						  const TransportCatalogue& catalogue);
 
@@ -43,6 +106,7 @@ namespace transport {
 		graph::DirectedWeightedGraph<double> graph_;
 		std::map<std::string, graph::VertexId> stop_ids_;
 		std::unique_ptr<graph::Router<double>> router_;
+		std::unique_ptr<graph::ShardedRouter<double>> sharded_router_;  // вместо router_ при разбиении на шарды
 	};
 
 }  // namespace transport
\ No newline at end of file
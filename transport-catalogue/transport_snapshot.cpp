@@ -0,0 +1,82 @@
+﻿#include "transport_snapshot.h"
+
+#include <atomic>
+#include <utility>
+
+
+namespace transport {
+
+    Snapshot::Snapshot(TransportCatalogue catalogue,
+                       RendererFactory make_renderer,
+                       RouterFactory make_router,
+                       uint64_t version,
+                       std::shared_ptr<const void> storage)
+        : storage_(std::move(storage))
+        , catalogue_(std::move(catalogue))
+        , make_renderer_(std::move(make_renderer))
+        , make_router_(std::move(make_router))
+        , version_(version)
+    {
+        // индексы каталога строятся лениво; у опубликованного снимка они должны быть готовы,
+        // чтобы читатели из разных потоков ничего не меняли
+        catalogue_.BuildIndexes();
+    }
+
+    std::shared_ptr<const Snapshot> Snapshot::Build(TransportCatalogue catalogue,
+                                                    renderer::RenderSettings render_settings,
+                                                    const RouterSettings& router_settings,
+                                                    uint64_t version) {
+        return std::make_shared<const Snapshot>(
+            std::move(catalogue),
+            [render_settings = std::move(render_settings)](const TransportCatalogue& catalogue) {
+                return renderer::MapRenderer(renderer::RenderSettings(render_settings), catalogue);
+            },
+            [router_settings](const TransportCatalogue& catalogue) {
+                return std::make_unique<const Router>(router_settings, catalogue);
+            },
+            version);
+    }
+
+    std::shared_ptr<const Snapshot> Snapshot::Update(TransportCatalogue catalogue, uint64_t version) const {
+        // маршруты новой версии переносятся из маршрутизатора этой
+        RouterFactory make_router = [previous = shared_from_this()](const TransportCatalogue& catalogue) {
+            return std::make_unique<const Router>(previous->GetRouter(), catalogue);
+        };
+        return std::make_shared<const Snapshot>(std::move(catalogue), make_renderer_, std::move(make_router), version);
+    }
+
+    const renderer::MapRenderer& Snapshot::GetRenderer() const {
+        std::call_once(renderer_once_, [this] {
+            renderer_.emplace(make_renderer_(catalogue_));
+        });
+        return *renderer_;
+    }
+
+    const Router& Snapshot::GetRouter() const {
+        std::call_once(router_once_, [this] {
+            router_ = make_router_(catalogue_);
+            make_router_ = nullptr;
+        });
+        return *router_;
+    }
+
+    SnapshotPublisher::SnapshotPublisher(std::shared_ptr<const Snapshot> snapshot)
+        : current_(std::move(snapshot))
+    {
+    }
+
+    std::shared_ptr<const Snapshot> SnapshotPublisher::Get() const {
+        return std::atomic_load(&current_);
+    }
+
+    bool SnapshotPublisher::Publish(std::shared_ptr<const Snapshot> snapshot) {
+        std::shared_ptr<const Snapshot> current = std::atomic_load(&current_);
+        do {
+            if (current && snapshot && current->GetVersion() >= snapshot->GetVersion()) {
+                return false;
+            }
+        } while (!std::atomic_compare_exchange_weak(&current_, &current, snapshot));
+        return true;
+    }
+
+}  // namespace transport
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace transport {
+
+	// Неизменяемый снимок данных одной версии: каталог с построенными индексами, маршрутизатор и отрисовщик.
+	// Снимок разделяется между потоками-читателями через shared_ptr и после создания не меняется,
+	// изменение каталога дает новый снимок.
+	// Маршрутизатор и отрисовщик строятся при первом обращении: запросам только к каталогу (Bus, Stop)
+	// не нужны ни граф с таблицей маршрутов, ни проекция карты
+	class Snapshot : public std::enable_shared_from_this<Snapshot> {
+	public:
+		// фабрики строят отрисовщик и маршрутизатор для каталога снимка
+		using RendererFactory = std::function<renderer::MapRenderer(const TransportCatalogue& catalogue)>;
+		using RouterFactory = std::function<std::unique_ptr<const Router>(const TransportCatalogue& catalogue)>;
+
+		// storage - память, на которую ссылаются части снимка (например, отображенный в память файл базы)
+		Snapshot(TransportCatalogue catalogue,
+				 RendererFactory make_renderer,
+				 RouterFactory make_router,
+				 uint64_t version = 0,
+				 std::shared_ptr<const void> storage = nullptr);
+
+		Snapshot(const Snapshot&) = delete;
+		Snapshot& operator=(const Snapshot&) = delete;
+
+		// снимок по каталогу с полным расчетом маршрутов
+		static std::shared_ptr<const Snapshot> Build(TransportCatalogue catalogue,
+													 renderer::RenderSettings render_settings,
+													 const RouterSettings& router_settings,
+													 uint64_t version = 0);
+
+		// следующая версия по измененному каталогу с теми же настройками:
+		// маршруты пересчитываются только в изменившихся компонентах графа.
+		// Эта версия живет, пока у следующей не построен маршрутизатор
+		std::shared_ptr<const Snapshot> Update(TransportCatalogue catalogue, uint64_t version) const;
+
+		const TransportCatalogue& GetCatalogue() const { return catalogue_; }
+
+		// строятся при первом вызове, вызовы из разных потоков безопасны
+		const renderer::MapRenderer& GetRenderer() const;
+		const Router& GetRouter() const;
+
+		uint64_t GetVersion() const { return version_; }
+
+	private:
+		std::shared_ptr<const void> storage_;
+		TransportCatalogue catalogue_;
+		RendererFactory make_renderer_;  // остается для следующих версий
+		mutable RouterFactory make_router_;  // освобождается после построения вместе с захваченными данными
+		mutable std::once_flag renderer_once_;
+		mutable std::optional<renderer::MapRenderer> renderer_;
+		mutable std::once_flag router_once_;
+		mutable std::unique_ptr<const Router> router_;
+		uint64_t version_ = 0;
+	};
+
+	// Текущая опубликованная версия снимка. Читатель берет снимок и работает с ним сколько нужно,
+	// писатель подменяет указатель атомарно и не ждет читателей: старый снимок освобождается,
+	// когда его отпустит последний читатель
+	class SnapshotPublisher {
+	public:
+		explicit SnapshotPublisher(std::shared_ptr<const Snapshot> snapshot = nullptr);
+
+		std::shared_ptr<const Snapshot> Get() const;
+
+		// публикует снимок, если он новее текущего; false, если другой писатель уже опубликовал
+		// версию не старее этой
+		bool Publish(std::shared_ptr<const Snapshot> snapshot);
+
+	private:
+		std::shared_ptr<const Snapshot> current_;
+	};
+
+}  // namespace transport
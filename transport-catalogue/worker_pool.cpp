@@ -0,0 +1,236 @@
+#include "worker_pool.h"
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TRANSPORT_WORKER_PROCESSES
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace workers {
+
+#ifdef TRANSPORT_WORKER_PROCESSES
+    namespace {
+
+        // Сообщение в сокете: длина (8 байт, порядок байтов хоста - оба конца на одной машине) и данные
+
+        bool WriteAll(int socket, const char* data, size_t size) {
+            while (size > 0) {
+                // MSG_NOSIGNAL: упавший обработчик дает ошибку записи, а не SIGPIPE
+                const ssize_t written = ::send(socket, data, size, MSG_NOSIGNAL);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        // false, если сокет закрыт раньше, чем пришли size байт
+        bool ReadAll(int socket, char* data, size_t size) {
+            while (size > 0) {
+                const ssize_t received = ::read(socket, data, size);
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received <= 0) {
+                    return false;
+                }
+                data += received;
+                size -= static_cast<size_t>(received);
+            }
+            return true;
+        }
+
+        bool WriteMessage(int socket, std::string_view message) {
+            const uint64_t size = message.size();
+            return WriteAll(socket, reinterpret_cast<const char*>(&size), sizeof(size))
+                && WriteAll(socket, message.data(), message.size());
+        }
+
+        bool ReadMessage(int socket, std::string& message) {
+            uint64_t size = 0;
+            if (!ReadAll(socket, reinterpret_cast<char*>(&size), sizeof(size))) {
+                return false;
+            }
+            message.resize(size);
+            return ReadAll(socket, message.data(), message.size());
+        }
+
+        void StopWorkers(std::vector<int>& sockets, std::vector<pid_t>& pids) {
+            for (const int socket : sockets) {
+                ::close(socket);
+            }
+            for (const pid_t pid : pids) {
+                while (::waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+                }
+            }
+            sockets.clear();
+            pids.clear();
+        }
+
+    }  // namespace
+#endif
+
+    WorkerPool::WorkerPool(size_t worker_count, BatchHandler handler)
+        : handler_(std::move(handler))
+    {
+#ifdef TRANSPORT_WORKER_PROCESSES
+        if (worker_count < 2) {
+            return;
+        }
+
+        std::vector<int> sockets;
+        std::vector<pid_t> pids;
+        for (size_t i = 0; i < worker_count; ++i) {
+            int pair[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                StopWorkers(sockets, pids);
+                throw std::runtime_error("Failed to create worker socket"s);
+            }
+
+            const pid_t pid = ::fork();
+            if (pid < 0) {
+                ::close(pair[0]);
+                ::close(pair[1]);
+                StopWorkers(sockets, pids);
+                throw std::runtime_error("Failed to start worker process"s);
+            }
+            if (pid == 0) {
+                // сокеты остальных обработчиков закрываются, иначе они не увидят закрытия своего сокета
+                ::close(pair[0]);
+                for (const int socket : sockets) {
+                    ::close(socket);
+                }
+                RunWorker(pair[1]);
+            }
+
+            ::close(pair[1]);
+            sockets.push_back(pair[0]);
+            pids.push_back(pid);
+        }
+
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.push_back({ pids[i], sockets[i] });
+        }
+#else
+        (void)worker_count;
+#endif
+    }
+
+    WorkerPool::~WorkerPool() {
+#ifdef TRANSPORT_WORKER_PROCESSES
+        std::vector<int> sockets;
+        std::vector<pid_t> pids;
+        for (const Worker& worker : workers_) {
+            sockets.push_back(worker.socket);
+            pids.push_back(worker.pid);
+        }
+        StopWorkers(sockets, pids);
+#endif
+    }
+
+    void WorkerPool::RunWorker(int socket) const {
+#ifdef TRANSPORT_WORKER_PROCESSES
+        // _exit: буферы и деструкторы принадлежат родительскому процессу
+        try {
+            std::string batch;
+            while (ReadMessage(socket, batch)) {
+                if (!WriteMessage(socket, handler_(batch))) {
+                    break;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            ::_exit(1);
+        }
+        ::_exit(0);
+#else
+        (void)socket;
+        throw std::logic_error("Worker processes are not supported"s);
+#endif
+    }
+
+    std::vector<std::string> WorkerPool::Process(const std::vector<std::string>& batches) {
+        std::vector<std::string> responses(batches.size());
+        if (workers_.empty()) {
+            for (size_t i = 0; i < batches.size(); ++i) {
+                responses[i] = handler_(batches[i]);
+            }
+            return responses;
+        }
+
+#ifdef TRANSPORT_WORKER_PROCESSES
+        // у каждого обработчика не больше одного пакета: пакеты достаются свободным обработчикам,
+        // и долгий пакет (например, Map) не задерживает остальные
+        const size_t no_batch = batches.size();
+        std::vector<size_t> assigned(workers_.size(), no_batch);
+        size_t next_batch = 0;
+        size_t done = 0;
+
+        const auto assign_next = [&](size_t worker) {
+            if (next_batch == batches.size()) {
+                return;
+            }
+            if (!WriteMessage(workers_[worker].socket, batches[next_batch])) {
+                throw std::runtime_error("Worker process failed"s);
+            }
+            assigned[worker] = next_batch++;
+        };
+
+        for (size_t worker = 0; worker < workers_.size(); ++worker) {
+            assign_next(worker);
+        }
+
+        std::vector<pollfd> busy;
+        std::vector<size_t> busy_workers;
+        while (done < batches.size()) {
+            busy.clear();
+            busy_workers.clear();
+            for (size_t worker = 0; worker < workers_.size(); ++worker) {
+                if (assigned[worker] != no_batch) {
+                    busy.push_back({ workers_[worker].socket, POLLIN, 0 });
+                    busy_workers.push_back(worker);
+                }
+            }
+
+            if (::poll(busy.data(), busy.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Failed to wait for worker processes"s);
+            }
+
+            for (size_t i = 0; i < busy.size(); ++i) {
+                if (busy[i].revents == 0) {
+                    continue;
+                }
+                const size_t worker = busy_workers[i];
+                if (!ReadMessage(workers_[worker].socket, responses[assigned[worker]])) {
+                    throw std::runtime_error("Worker process failed"s);
+                }
+                ++done;
+                assigned[worker] = no_batch;
+                assign_next(worker);
+            }
+        }
+#endif
+        return responses;
+    }
+
+}  // namespace workers
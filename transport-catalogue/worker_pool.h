@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace workers {
+
+    struct WorkerPoolSettings {
+        // больше обработчиков, чем ядер, ничего не ускоряет; предел не дает ошибке в настройках
+        // породить процессы до исчерпания их лимита
+        static constexpr size_t MAX_WORKER_COUNT = 64;
+
+        size_t worker_count = 1;  // 1 - запросы обрабатываются в текущем процессе
+        size_t batch_size = 64;   // запросов в одном пакете
+    };
+
+    // обработка пакета в процессе-обработчике: текст пакета запросов -> текст ответа
+    using BatchHandler = std::function<std::string(std::string_view)>;
+
+    // Пул процессов-обработчиков. Обработчики порождаются fork() от текущего процесса и видят
+    // его память как есть: загруженный каталог и таблицы маршрутов не копируются (страницы
+    // только читаются и остаются общими), а каждый обработчик однопоточный.
+    // Пакеты передаются обработчикам через Unix-сокеты, свободный обработчик получает следующий пакет.
+    // Без fork() (не POSIX) пакеты обрабатываются в текущем процессе
+    class WorkerPool {
+    public:
+        // пул создается до того, как процесс запустит свои потоки
+        WorkerPool(size_t worker_count, BatchHandler handler);
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // закрывает сокеты и дожидается завершения обработчиков
+        ~WorkerPool();
+
+        // ответы на пакеты в порядке пакетов; если обработчик завершился с ошибкой, бросает runtime_error
+        std::vector<std::string> Process(const std::vector<std::string>& batches);
+
+    private:
+        struct Worker {
+            int pid = -1;
+            int socket = -1;
+        };
+
+        BatchHandler handler_;
+        std::vector<Worker> workers_;
+
+        // цикл процесса-обработчика: читает пакеты до закрытия сокета
+        [[noreturn]] void RunWorker(int socket) const;
+    };
+
+}  // namespace workers